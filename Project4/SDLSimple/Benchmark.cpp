@@ -0,0 +1,877 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <iostream>
+#include <new>
+#include <random>
+#include "Entity.h"
+#include "TextCache.h"
+#include "RenderQueue.h"
+#include "Camera.h"
+#include "VisibilityIndex.h"
+#include "SpatialHash.h"
+#include "StaticBVH.h"
+#include "OverlapKernel.h"
+#include "Benchmark.h"
+
+constexpr float BENCH_TIMESTEP = 1.0f / 60.0f;
+constexpr int   BENCH_STEPS    = 2000,
+                BENCH_JUMP_INTERVAL = 45;
+
+constexpr int BENCH_PLATFORM_COUNTS[] = { 45, 1000, 10000, 100000 };
+
+constexpr int BENCH_QUERY_COUNT = 100000;
+
+constexpr float BENCH_STEP_RATES[]    = { 60.0f, 30.0f, 20.0f };
+constexpr float BENCH_SECONDS         = 30.0f,
+                BENCH_SAMPLE_INTERVAL = 0.1f,  // a multiple of every step above
+                BENCH_JUMP_PERIOD     = 0.8f;
+constexpr float BENCH_DRIFT_TOLERANCE = 0.001f; // how much further continuous mode may drift than discrete
+constexpr float BENCH_DROP_HEIGHTS[]  = { 0.5f, 2.0f, 8.0f, 32.0f };
+constexpr float BENCH_DROP_SPEEDS[]   = { 0.0f, 5.0f, 10.0f, 20.0f };
+
+constexpr int BENCH_CROWD_SIZES[]  = { 3, 100, 1000, 10000 };
+constexpr int BENCH_CROWD_STEPS    = 1200,
+              BENCH_REPORT_STEPS   = 300;
+
+constexpr int BENCH_ENEMY_COUNTS[] = { 1000, 10000, 50000 };
+constexpr int BENCH_ENEMY_STEPS    = 300;
+
+constexpr int      BENCH_REPLAY_STEPS = 20000;
+constexpr uint32_t BENCH_REPLAY_SEED  = 3113;
+
+constexpr int BENCH_BOX_COUNTS[]   = { 16, 64, 1000, 100000 };
+constexpr int BENCH_BOX_TESTS      = 20000000; // box tests per kernel and box count
+
+constexpr int BENCH_QUEUE_SIZES[]   = { 1000, 10000, 100000 };
+constexpr int BENCH_QUEUE_TEXTURES  = 8,
+              BENCH_QUEUE_LAYERS    = 4,
+              BENCH_QUEUE_REPEATS   = 20;
+
+constexpr int   BENCH_CULL_COUNTS[]   = { 1000, 10000, 100000 };
+constexpr int   BENCH_CULL_FRAMES     = 2000;
+constexpr float BENCH_CULL_SPACING    = 1.5f; // platforms per unit of level, inverted
+
+constexpr int BENCH_TEXT_FRAMES = 20000,
+              BENCH_TEXT_WARMUP = 100; // frames before allocations start to count
+
+// Counting allocations means replacing the global operator new, which would take the
+// whole game with it, so only builds compiled with BENCH_COUNT_ALLOCATIONS do it.
+// There, every heap allocation passes through here but is only counted while a
+// benchmark asks, so the text benchmark can prove a steady state allocates nothing.
+static bool s_count_allocations = false;
+static long s_allocation_count  = 0;
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+// All three stay out of line: inlined into this file's own news and deletes, GCC sees
+// malloc paired with delete, or new with free, and warns (-Wmismatched-new-delete)
+__attribute__((noinline))
+void* operator new(std::size_t size)
+{
+    if (s_count_allocations) s_allocation_count++;
+
+    void *memory = malloc(size == 0 ? 1 : size);
+    if (memory == NULL) throw std::bad_alloc();
+    return memory;
+}
+
+__attribute__((noinline)) void operator delete(void *memory) noexcept              { free(memory); }
+__attribute__((noinline)) void operator delete(void *memory, std::size_t) noexcept { ::operator delete(memory); }
+#endif
+
+// Floor tiles plus three rows of thin floating platforms, four platforms per
+// column, the way the real level is laid out but repeated to the right.
+void build_benchmark_level(Entity *platforms, int platform_count)
+{
+    for (int i = 0; i < platform_count; i++)
+    {
+        int column = i / 4,
+            row    = i % 4;
+
+        platforms[i].set_entity_type(PLATFORM);
+        if (row == 0)
+        {
+            platforms[i].set_position(glm::vec3(column - 4.0f, -3.5f, 0.0f));
+            platforms[i].set_width(1.35f);
+            platforms[i].set_height(1.35f);
+        } else
+        {
+            platforms[i].set_position(glm::vec3(column * 1.0f - 4.0f + row * 0.3f, -3.5f + row * 1.1f, 0.0f));
+            platforms[i].set_width(0.6f);
+            platforms[i].set_height(0.09f);
+        }
+    }
+}
+
+Entity* create_benchmark_player()
+{
+    int walking[4][3] = { { 0, 1, 2 }, { 3, 4, 5 }, { 6, 7, 8 }, { 9, 10, 11 } };
+
+    Entity *player = new Entity(0, 3.0f, glm::vec3(0.0f, -9.8f, 0.0f), 4.5f, walking, 0.0f,
+                                3, 0, 3, 4, 0.22f, 0.44f, PLAYER);
+    player->set_position(glm::vec3(-4.0f, -2.0f, 0.0f));
+    return player;
+}
+
+// Steps the player through the level and returns the mean microseconds per step.
+// The trajectory is written to trajectory so that two runs can be compared exactly.
+double simulate(PhysicsWorld &world, const Broadphase *broadphase, std::vector<glm::vec3> &trajectory)
+{
+    Entity *player = create_benchmark_player();
+    world.set_broadphase(broadphase);
+    trajectory.clear();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < BENCH_STEPS; step++)
+    {
+        player->move_right();
+        if (step % BENCH_JUMP_INTERVAL == 0 && player->get_collided_bottom()) player->jump();
+
+        player->update(BENCH_TIMESTEP, NULL);
+        world.step(BENCH_TIMESTEP);
+        trajectory.push_back(player->get_position());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    delete player;
+    return std::chrono::duration<double, std::micro>(end - start).count() / BENCH_STEPS;
+}
+
+void run_collision_benchmark()
+{
+    std::cout << "platforms\tlinear us/step\tgrid us/step\tbvh us/step\tcached us/step\tcache hits\tidentical\n";
+
+    for (int platform_count : BENCH_PLATFORM_COUNTS)
+    {
+        PhysicsWorld world;
+        world.make_current();
+
+        Entity *platforms = new Entity[platform_count];
+        build_benchmark_level(platforms, platform_count);
+        world.build_static_broadphase();
+
+        std::vector<AABB> bounds;
+        world.get_static_bounds(bounds);
+
+        SpatialHash grid;
+        for (int i = 0; i < (int) bounds.size(); i++) grid.insert(i, bounds[i]);
+
+        std::vector<glm::vec3> linear_trajectory, grid_trajectory, bvh_trajectory, cached_trajectory;
+        world.set_contact_caching(false);
+        double linear_cost = simulate(world, nullptr, linear_trajectory);
+        double grid_cost   = simulate(world, &grid, grid_trajectory);
+        double bvh_cost    = simulate(world, world.get_static_bvh(), bvh_trajectory);
+
+        world.set_contact_caching(true);
+        world.reset_cache_counters();
+        double cached_cost = simulate(world, world.get_static_bvh(), cached_trajectory);
+        double hit_rate    = 100.0 * world.get_cache_hits() / (world.get_cache_hits() + world.get_cache_misses());
+
+        bool identical = linear_trajectory == grid_trajectory && linear_trajectory == bvh_trajectory &&
+                         linear_trajectory == cached_trajectory;
+        std::cout << platform_count << "\t\t" << linear_cost << "\t\t" << grid_cost << "\t\t"
+                  << bvh_cost << "\t\t" << cached_cost << "\t\t" << hit_rate << "%\t\t"
+                  << (identical ? "yes" : "NO") << '\n';
+
+        delete [] platforms;
+    }
+}
+
+void run_bvh_benchmark()
+{
+    std::cout << "platforms\tnodes\tbuild ms\tquery ns\tvalidated\n";
+
+    for (int platform_count : BENCH_PLATFORM_COUNTS)
+    {
+        PhysicsWorld world;
+        world.make_current();
+
+        Entity *platforms = new Entity[platform_count];
+        build_benchmark_level(platforms, platform_count);
+
+        auto build_start = std::chrono::steady_clock::now();
+        world.build_static_broadphase();
+        auto build_end = std::chrono::steady_clock::now();
+        StaticBVH &bvh = *world.get_static_bvh();
+
+        // Player-sized boxes spread evenly over the level
+        float level_width = platform_count / 4.0f;
+        std::vector<AABB> queries;
+        for (int i = 0; i < BENCH_QUERY_COUNT; i++)
+        {
+            float x = -4.0f + level_width * i / BENCH_QUERY_COUNT,
+                  y = -3.5f + (i % 7) * 0.6f;
+            queries.push_back({ x - 0.11f, y - 0.22f, x + 0.11f, y + 0.22f });
+        }
+
+        std::vector<int> candidates;
+        size_t candidate_total = 0;
+        auto query_start = std::chrono::steady_clock::now();
+        for (const AABB &query : queries)
+        {
+            bvh.query(query, candidates);
+            candidate_total += candidates.size();
+        }
+        auto query_end = std::chrono::steady_clock::now();
+
+        // Validation mode: every query made while stepping is checked against a linear scan
+        bvh.set_validate(true);
+        world.set_contact_caching(false);
+        std::vector<glm::vec3> linear_trajectory, bvh_trajectory;
+        simulate(world, nullptr, linear_trajectory);
+        simulate(world, &bvh, bvh_trajectory);
+        for (int i = 0; i < (int) queries.size(); i += queries.size() / 1000) bvh.query(queries[i], candidates);
+
+        std::cout << platform_count << "\t\t" << bvh.get_node_count() << "\t"
+                  << std::chrono::duration<double, std::milli>(build_end - build_start).count() << "\t\t"
+                  << std::chrono::duration<double, std::nano>(query_end - query_start).count() / BENCH_QUERY_COUNT
+                  << "\t\t" << (linear_trajectory == bvh_trajectory ? "yes" : "NO")
+                  << " (" << candidate_total << " candidates)" << '\n';
+
+        delete [] platforms;
+    }
+}
+
+// Runs and jumps along an unbroken floor in wall-clock time rather than steps, so that
+// runs at different rates can be compared, sampling the player every BENCH_SAMPLE_INTERVAL.
+// The full benchmark level is no use here: whether a jump clears a platform's corner
+// or catches its side by a hair flips on rounding, and the runs part ways after that.
+static void simulate_at_rate(float rate, bool continuous, std::vector<glm::vec3> &samples)
+{
+    PhysicsWorld world;
+    world.make_current();
+    world.set_continuous(continuous);
+
+    int floor_count = (int) (BENCH_SECONDS * 3.0f) + 8;
+    Entity *platforms = new Entity[floor_count];
+    for (int i = 0; i < floor_count; i++)
+    {
+        platforms[i].set_entity_type(PLATFORM);
+        platforms[i].set_position(glm::vec3(i - 4.0f, -3.5f, 0.0f));
+        platforms[i].set_width(1.35f);
+        platforms[i].set_height(1.35f);
+    }
+    world.build_static_broadphase();
+
+    Entity *player = create_benchmark_player();
+    samples.clear();
+
+    int steps             = (int) roundf(BENCH_SECONDS * rate),
+        steps_per_sample  = (int) roundf(BENCH_SAMPLE_INTERVAL * rate),
+        steps_per_jump    = (int) roundf(BENCH_JUMP_PERIOD * rate);
+    for (int step = 0; step < steps; step++)
+    {
+        player->move_right();
+        if (step % steps_per_jump == 0 && player->get_collided_bottom()) player->jump();
+
+        player->update(1.0f / rate, NULL);
+        world.step(1.0f / rate);
+        if ((step + 1) % steps_per_sample == 0) samples.push_back(player->get_position());
+    }
+
+    delete player;
+    delete [] platforms;
+}
+
+// Drops a player-sized body onto a single thin platform and reports whether it came
+// to rest on top of it
+static bool drop_lands(float rate, bool continuous, float height, float speed)
+{
+    PhysicsWorld world;
+    world.make_current();
+    world.set_continuous(continuous);
+
+    Entity platform;
+    platform.set_entity_type(PLATFORM);
+    platform.set_width(0.6f);
+    platform.set_height(0.09f);
+    world.build_static_broadphase();
+
+    Entity *player = create_benchmark_player();
+    player->set_position(glm::vec3(0.0f, 0.045f + 0.22f + height, 0.0f));
+    player->set_velocity(glm::vec3(0.0f, -speed, 0.0f));
+
+    float drop_time = (speed + sqrtf(speed * speed + 2.0f * 9.8f * height)) / 9.8f;
+    int   steps     = (int) ((drop_time + 1.0f) * rate);
+    for (int step = 0; step < steps; step++) world.step(1.0f / rate);
+
+    bool landed = player->get_collided_bottom() && player->get_position().y > 0.0f;
+    delete player;
+    return landed;
+}
+
+// Checks continuous mode against what the game ships, discrete steps at 60 Hz: it must
+// match that bit for bit at 60 Hz, drift no further than discrete mode at lower rates,
+// and never tunnel. Returns false, after the tables, if any of that fails.
+bool run_timestep_benchmark()
+{
+    std::vector<glm::vec3> shipped, samples;
+    simulate_at_rate(BENCH_STEP_RATES[0], false, shipped);
+
+    bool passed = true;
+    std::cout << "rate\tmode\t\tmax deviation\tfinal deviation\tok\n";
+    for (float rate : BENCH_STEP_RATES)
+    {
+        float discrete_deviation = 0.0f;
+        for (bool continuous : { false, true })
+        {
+            simulate_at_rate(rate, continuous, samples);
+
+            float max_deviation = 0.0f;
+            for (int i = 0; i < (int) samples.size() && i < (int) shipped.size(); i++)
+                max_deviation = std::max(max_deviation, glm::length(samples[i] - shipped[i]));
+
+            bool ok = true;
+            if (!continuous) discrete_deviation = max_deviation;
+            else if (rate == BENCH_STEP_RATES[0]) ok = samples == shipped;
+            else ok = max_deviation <= discrete_deviation + BENCH_DRIFT_TOLERANCE;
+            passed = passed && ok;
+
+            std::cout << rate << "\t" << (continuous ? "continuous" : "discrete  ") << "\t"
+                      << max_deviation << "\t\t" << glm::length(samples.back() - shipped.back()) << "\t\t"
+                      << (ok ? "yes" : "NO") << '\n';
+        }
+    }
+
+    std::cout << "\nrate\tmode\t\ttunnelled (of "
+              << std::size(BENCH_DROP_HEIGHTS) * std::size(BENCH_DROP_SPEEDS) << " drops)\tok\n";
+    for (float rate : BENCH_STEP_RATES)
+    {
+        for (bool continuous : { false, true })
+        {
+            int tunnelled = 0;
+            for (float height : BENCH_DROP_HEIGHTS)
+                for (float speed : BENCH_DROP_SPEEDS)
+                    if (!drop_lands(rate, continuous, height, speed)) tunnelled++;
+
+            bool ok = !continuous || tunnelled == 0;
+            passed = passed && ok;
+
+            std::cout << rate << "\t" << (continuous ? "continuous" : "discrete  ") << "\t"
+                      << tunnelled << "\t\t\t" << (ok ? "yes" : "NO") << '\n';
+        }
+    }
+
+    std::cout << "\ntimestep check " << (passed ? "passed" : "FAILED") << '\n';
+    return passed;
+}
+
+// Idle guards stand two to a floor tile while the player runs right through them,
+// stepped the same way as the game loop. Returns the mean microseconds per step and
+// prints the awake and sleeping counts every BENCH_REPORT_STEPS.
+static double simulate_crowd(int guard_count, bool sleeping, bool report)
+{
+    PhysicsWorld world;
+    world.make_current();
+    world.set_sleeping(sleeping);
+
+    int floor_count = guard_count / 2 + 8;
+    Entity *platforms = new Entity[floor_count];
+    for (int i = 0; i < floor_count; i++)
+    {
+        platforms[i].set_entity_type(PLATFORM);
+        platforms[i].set_position(glm::vec3(i - 4.0f, -3.5f, 0.0f));
+        platforms[i].set_width(1.35f);
+        platforms[i].set_height(1.35f);
+    }
+    world.build_static_broadphase();
+
+    Entity *player = create_benchmark_player();
+    Entity *guards = new Entity[guard_count];
+    for (int i = 0; i < guard_count; i++)
+    {
+        guards[i] = Entity(0, 1.0f, 0.5f, 0.7f, ENEMY, GUARD, IDLE);
+        guards[i].set_position(glm::vec3(i * 0.5f, -2.475f, 0.0f));
+        guards[i].set_acceleration(glm::vec3(0.0f, -9.81f, 0.0f));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < BENCH_CROWD_STEPS; step++)
+    {
+        PlayerSnapshot snapshot = player->get_snapshot();
+        player->move_right();
+        player->update(BENCH_TIMESTEP, NULL);
+
+        world.wake_near(snapshot.position, Entity::AI_WAKE_RADIUS);
+        for (int i = 0; i < guard_count; i++)
+        {
+            if (!guards[i].get_is_active() || guards[i].get_is_sleeping()) continue;
+            guards[i].update(BENCH_TIMESTEP, &snapshot);
+        }
+        world.step(BENCH_TIMESTEP);
+
+        if (report && (step + 1) % BENCH_REPORT_STEPS == 0)
+            std::cout << "\tstep " << step + 1 << ": awake " << world.get_awake_count()
+                      << ", sleeping " << world.get_sleeping_count() << '\n';
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    delete [] guards;
+    delete player;
+    delete [] platforms;
+    return std::chrono::duration<double, std::micro>(end - start).count() / BENCH_CROWD_STEPS;
+}
+
+void run_sleep_benchmark()
+{
+    // The first run in the process pays for warming up, so keep it out of the table
+    simulate_crowd(BENCH_CROWD_SIZES[0], true, false);
+
+    std::cout << "guards\talways awake us/step\tsleeping us/step\n";
+
+    for (int guard_count : BENCH_CROWD_SIZES)
+    {
+        double awake_cost    = simulate_crowd(guard_count, false, false);
+        double sleeping_cost = simulate_crowd(guard_count, true, false);
+        std::cout << guard_count << "\t" << awake_cost << "\t\t\t" << sleeping_cost << '\n';
+    }
+
+    std::cout << "\ncounts for " << BENCH_CROWD_SIZES[2] << " guards:\n";
+    simulate_crowd(BENCH_CROWD_SIZES[2], true, true);
+}
+
+// Patrollers spread along a long floor, with the player standing at the start.
+// Only the enemy update is timed; the hash covers every enemy's exact position.
+static double simulate_enemies(JobSystem &jobs, int enemy_count, uint64_t &hash);
+
+// FNV-1a over the exact bits of a value
+static void hash_bits(uint64_t &hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char*) data;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+}
+
+// Drives the player and a patrolling and a guarding enemy from a seeded input stream,
+// the way process_input would, and hashes every position. mt19937's raw output is
+// fixed by the standard, unlike the distributions, so the stream is the same everywhere.
+static uint64_t replay(bool continuous, double &cost)
+{
+    PhysicsWorld world;
+    world.make_current();
+    world.set_continuous(continuous);
+
+    Entity *platforms = new Entity[BENCH_PLATFORM_COUNTS[1]];
+    build_benchmark_level(platforms, BENCH_PLATFORM_COUNTS[1]);
+    world.build_static_broadphase();
+
+    Entity *player  = create_benchmark_player();
+    Entity *enemies = new Entity[2];
+    enemies[0] = Entity(0, -1.0f, 0.5f, 0.7f, ENEMY, PATROLLING, RIGHTMOVING);
+    enemies[1] = Entity(0, 1.0f, 0.7f, 0.7f, ENEMY, GUARD, IDLE);
+    enemies[0].set_position(glm::vec3(-1.3f, 0.5f, 0.0f));
+    enemies[1].set_position(glm::vec3(1.7f, -2.0f, 0.0f));
+    for (int i = 0; i < 2; i++) enemies[i].set_acceleration(glm::vec3(0.0f, -9.81f, 0.0f));
+
+    std::mt19937 inputs(BENCH_REPLAY_SEED);
+    uint64_t hash = 14695981039346656037ull;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < BENCH_REPLAY_STEPS; step++)
+    {
+        // Hold each input for a quarter of a second, as a player would
+        if (step % 15 == 0)
+        {
+            uint32_t buttons = inputs();
+            player->set_movement(glm::vec3(0.0f));
+            player->set_un_hiding();
+            if (buttons & 1)      player->move_left();
+            else if (buttons & 2) player->move_right();
+            else if (buttons & 4) player->set_hiding();
+            if ((buttons & 8) && !player->get_isHide() && player->get_collided_bottom()) player->jump();
+        }
+
+        PlayerSnapshot snapshot = player->get_snapshot();
+        player->update(BENCH_TIMESTEP, NULL);
+        world.wake_near(snapshot.position, Entity::AI_WAKE_RADIUS);
+        for (int i = 0; i < 2; i++)
+            if (enemies[i].get_is_active() && !enemies[i].get_is_sleeping()) enemies[i].update(BENCH_TIMESTEP, &snapshot);
+        world.step(BENCH_TIMESTEP);
+
+        for (Entity *entity : { player, &enemies[0], &enemies[1] })
+        {
+            Scalar x = world.get_exact_x(entity->get_body_index()), y = world.get_exact_y(entity->get_body_index());
+            hash_bits(hash, &x, sizeof(x));
+            hash_bits(hash, &y, sizeof(y));
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    cost = std::chrono::duration<double, std::micro>(end - start).count() / BENCH_REPLAY_STEPS;
+
+    delete [] enemies;
+    delete player;
+    delete [] platforms;
+    return hash;
+}
+
+void run_replay_benchmark()
+{
+#ifdef PHYSICS_FIXED_POINT
+    std::cout << "physics: Q16.16 fixed point\n";
+#else
+    std::cout << "physics: float\n";
+#endif
+    std::cout << "mode\t\tus/step\tchecksum\t\trepeatable\n";
+
+    for (bool continuous : { false, true })
+    {
+        double cost, repeat_cost;
+        uint64_t hash = replay(continuous, cost), repeat = replay(continuous, repeat_cost);
+
+        std::cout << (continuous ? "continuous" : "discrete  ") << "\t" << cost << "\t"
+                  << std::hex << hash << std::dec << "\t" << (hash == repeat ? "yes" : "NO") << '\n';
+    }
+}
+
+static double simulate_enemies(JobSystem &jobs, int enemy_count, uint64_t &hash)
+{
+    PhysicsWorld world;
+    world.make_current();
+
+    int floor_count = enemy_count / 4 + 8;
+    Entity *platforms = new Entity[floor_count];
+    for (int i = 0; i < floor_count; i++)
+    {
+        platforms[i].set_entity_type(PLATFORM);
+        platforms[i].set_position(glm::vec3(i - 4.0f, -3.5f, 0.0f));
+        platforms[i].set_width(1.35f);
+        platforms[i].set_height(1.35f);
+    }
+    world.build_static_broadphase();
+
+    Entity *player  = create_benchmark_player();
+    Entity *enemies = new Entity[enemy_count];
+    for (int i = 0; i < enemy_count; i++)
+    {
+        enemies[i] = Entity(0, -1.0f, 0.5f, 0.7f, ENEMY, PATROLLING, RIGHTMOVING);
+        enemies[i].set_position(glm::vec3(i * 0.25f, -2.475f, 0.0f));
+        enemies[i].set_acceleration(glm::vec3(0.0f, -9.81f, 0.0f));
+    }
+
+    double update_time = 0.0;
+    for (int step = 0; step < BENCH_ENEMY_STEPS; step++)
+    {
+        PlayerSnapshot snapshot = player->get_snapshot();
+        player->update(BENCH_TIMESTEP, NULL);
+
+        auto start = std::chrono::steady_clock::now();
+        Entity::update_all(&jobs, enemies, enemy_count, BENCH_TIMESTEP, &snapshot);
+        auto end = std::chrono::steady_clock::now();
+        update_time += std::chrono::duration<double, std::micro>(end - start).count();
+
+        world.step(BENCH_TIMESTEP);
+    }
+
+    hash = 14695981039346656037ull;
+    for (int i = 0; i < enemy_count; i++)
+    {
+        Scalar x = world.get_exact_x(enemies[i].get_body_index()), y = world.get_exact_y(enemies[i].get_body_index());
+        hash_bits(hash, &x, sizeof(x));
+        hash_bits(hash, &y, sizeof(y));
+    }
+
+    delete [] enemies;
+    delete player;
+    delete [] platforms;
+    return update_time / BENCH_ENEMY_STEPS;
+}
+
+void run_enemy_benchmark()
+{
+    JobSystem serial(0), parallel;
+    std::cout << "workers: " << parallel.get_worker_count() << " plus the calling thread\n";
+    std::cout << "enemies\tserial us/update\tparallel us/update\tspeedup\tidentical\n";
+
+    for (int enemy_count : BENCH_ENEMY_COUNTS)
+    {
+        uint64_t serial_hash, parallel_hash;
+        double serial_cost   = simulate_enemies(serial, enemy_count, serial_hash);
+        double parallel_cost = simulate_enemies(parallel, enemy_count, parallel_hash);
+
+        std::cout << enemy_count << "\t" << serial_cost << "\t\t\t" << parallel_cost << "\t\t\t"
+                  << serial_cost / parallel_cost << "x\t" << (serial_hash == parallel_hash ? "yes" : "NO") << '\n';
+    }
+}
+
+void run_overlap_benchmark()
+{
+    const OverlapKernelType kernels[] = { OVERLAP_SCALAR, OVERLAP_SSE, OVERLAP_AVX2, OVERLAP_NEON };
+    OverlapKernelType best = get_overlap_kernel();
+
+    std::cout << "boxes\tkernel\tns/box\tspeedup\tmatches scalar\n";
+
+    std::mt19937 random(3113);
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f), extent(0.05f, 1.5f);
+
+    for (int box_count : BENCH_BOX_COUNTS)
+    {
+        std::vector<float> x(box_count), y(box_count), half_width(box_count), half_height(box_count);
+        for (int i = 0; i < box_count; i++)
+        {
+            x[i] = position(random); half_width[i]  = extent(random);
+            y[i] = position(random); half_height[i] = extent(random);
+        }
+        BoxArrays boxes = { x.data(), y.data(), half_width.data(), half_height.data() };
+
+        // Movers sweep the box field so that every kernel sees the same mix of hits and misses
+        int passes = std::max(1, BENCH_BOX_TESTS / box_count);
+        std::vector<uint32_t> mask(get_overlap_mask_words(box_count)), scalar_mask;
+        double scalar_cost = 0.0;
+
+        for (OverlapKernelType kernel : kernels)
+        {
+            if (!set_overlap_kernel(kernel)) continue;
+
+            uint32_t checksum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int pass = 0; pass < passes; pass++)
+            {
+                float mover = -50.0f + 100.0f * pass / passes;
+                overlap_mask(mover, -mover, 2.0f, 2.0f, boxes, box_count, mask.data());
+                checksum += mask[pass % mask.size()];
+            }
+            auto end = std::chrono::steady_clock::now();
+            double cost = std::chrono::duration<double, std::nano>(end - start).count() / ((double) passes * box_count);
+
+            // Every kernel must agree bit for bit with the scalar one
+            overlap_mask(0.5f, -0.25f, 10.0f, 10.0f, boxes, box_count, mask.data());
+            if (kernel == OVERLAP_SCALAR)
+            {
+                scalar_mask = mask;
+                scalar_cost = cost;
+            }
+
+            std::cout << box_count << "\t" << get_overlap_kernel_name(kernel) << "\t" << cost << "\t"
+                      << scalar_cost / cost << "x\t" << (mask == scalar_mask ? "yes" : "NO")
+                      << " (checksum " << checksum << ")" << '\n';
+        }
+    }
+
+    set_overlap_kernel(best);
+}
+
+enum TextLayout { TEXT_PER_CALL, TEXT_SCRATCH, TEXT_CACHED };
+
+// Lays out the game's text for a number of frames, the way each mode would, and
+// returns the mean microseconds per frame. TEXT_PER_CALL builds into a fresh buffer on
+// every call, as draw_text used to; TEXT_SCRATCH rebuilds into one reused mesh;
+// TEXT_CACHED keeps the fixed strings. The frame counter is dynamic in every mode.
+static double lay_out_text(TextLayout layout, long &allocations)
+{
+    const char *fixed_text[] = { "left-move left  right-move right", "space-jump  down-hide(hide you from attack)",
+                                 "You Win!" };
+
+    TextCache cache;
+    AtlasRegion font;
+    std::vector<float> stream;
+    stream.reserve(256 * SpriteBatch::VERTICES_PER_SPRITE * SpriteBatch::FLOATS_PER_VERTEX);
+    char dynamic_text[32];
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < BENCH_TEXT_FRAMES; frame++)
+    {
+        if (frame == BENCH_TEXT_WARMUP)
+        {
+            s_allocation_count  = 0;
+            s_count_allocations = true;
+            start = std::chrono::steady_clock::now();
+        }
+
+        stream.clear();
+        for (const char *text : fixed_text)
+        {
+            if (layout == TEXT_PER_CALL)
+            {
+                std::vector<float> fresh;
+                TextCache::build_mesh(fresh, font, text, 0.23f, 0.0f);
+                SpriteBatch::append_mesh(stream, fresh, glm::vec3(-4.8f, -3.3f, 0.0f));
+            }
+            else if (layout == TEXT_SCRATCH)
+            {
+                SpriteBatch::append_mesh(stream, cache.get_scratch_mesh(font, text, 0.23f, 0.0f), glm::vec3(-4.8f, -3.3f, 0.0f));
+            }
+            else SpriteBatch::append_mesh(stream, cache.get_mesh(font, text, 0.23f, 0.0f), glm::vec3(-4.8f, -3.3f, 0.0f));
+        }
+
+        snprintf(dynamic_text, sizeof(dynamic_text), "frame %d", frame);
+        SpriteBatch::append_mesh(stream, cache.get_scratch_mesh(font, dynamic_text, 0.5f, 0.05f), glm::vec3(-3.5f, 2.0f, 0.0f));
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    s_count_allocations = false;
+    allocations = s_allocation_count;
+    return std::chrono::duration<double, std::micro>(end - start).count() / (BENCH_TEXT_FRAMES - BENCH_TEXT_WARMUP);
+}
+
+void run_text_benchmark()
+{
+    const char *names[] = { "per call", "scratch ", "cached  " };
+
+    std::cout << "layout\t\tus/frame\tallocations after warm-up\n";
+    for (TextLayout layout : { TEXT_PER_CALL, TEXT_SCRATCH, TEXT_CACHED })
+    {
+        long allocations;
+        double cost = lay_out_text(layout, allocations);
+        std::cout << names[layout] << "\t" << cost << "\t\t";
+#ifdef BENCH_COUNT_ALLOCATIONS
+        std::cout << allocations << '\n';
+#else
+        std::cout << "not counted\n";
+#endif
+    }
+}
+
+// Texture changes a batch would make drawing the commands in this order
+static int count_texture_changes(const std::vector<GLuint> &textures)
+{
+    int changes = 0;
+    for (size_t i = 0; i < textures.size(); i++) changes += (i == 0 || textures[i] != textures[i - 1]);
+    return changes;
+}
+
+void run_render_queue_benchmark()
+{
+    std::cout << "sprites\tchanges submitted\tchanges sorted\tradix us\tstd::stable_sort us\tsame order\n";
+
+    std::mt19937 random(3113);
+    for (int sprite_count : BENCH_QUEUE_SIZES)
+    {
+        std::uniform_int_distribution<int> texture(1, BENCH_QUEUE_TEXTURES), layer(0, BENCH_QUEUE_LAYERS - 1);
+        std::uniform_real_distribution<float> depth(-1.0f, 1.0f);
+
+        std::vector<GLuint>  textures(sprite_count);
+        std::vector<uint8_t> layers(sprite_count);
+        std::vector<float>   depths(sprite_count);
+        for (int i = 0; i < sprite_count; i++)
+        {
+            textures[i] = texture(random);
+            layers[i]   = layer(random);
+            depths[i]   = depth(random);
+        }
+
+        // Submission order, as render() would draw it without the queue; layers
+        // would then be interleaved too, so this is only a count of binds
+        int submitted_changes = count_texture_changes(textures);
+
+        RenderQueue queue;
+        double radix_cost = 0.0;
+        std::vector<GLuint> sorted_textures(sprite_count);
+        std::vector<uint64_t> radix_keys(sprite_count);
+        for (int repeat = 0; repeat < BENCH_QUEUE_REPEATS; repeat++)
+        {
+            for (int i = 0; i < sprite_count; i++)
+            {
+                queue.submit_sprite(layers[i], textures[i], Transform2D(), glm::vec2(0.0f), glm::vec2(1.0f), depths[i]);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            queue.sort();
+            auto end = std::chrono::steady_clock::now();
+            radix_cost += std::chrono::duration<double, std::micro>(end - start).count();
+
+            for (int i = 0; i < sprite_count; i++)
+            {
+                sorted_textures[i] = queue.get_sorted_command(i).texture_id;
+                radix_keys[i]      = queue.get_sorted_key(i);
+            }
+            queue.clear();
+        }
+
+        double stable_cost = 0.0;
+        std::vector<std::pair<uint64_t, int>> keys(sprite_count);
+        for (int repeat = 0; repeat < BENCH_QUEUE_REPEATS; repeat++)
+        {
+            for (int i = 0; i < sprite_count; i++)
+            {
+                keys[i] = { RenderQueue::make_key(layers[i], RenderQueue::SHADER_SPRITE, textures[i], depths[i]), i };
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            std::stable_sort(keys.begin(), keys.end(), [](const std::pair<uint64_t, int> &a, const std::pair<uint64_t, int> &b) {
+                return a.first < b.first;
+            });
+            auto end = std::chrono::steady_clock::now();
+            stable_cost += std::chrono::duration<double, std::micro>(end - start).count();
+        }
+
+        bool same_order = true;
+        for (int i = 0; i < sprite_count; i++) same_order &= keys[i].first == radix_keys[i];
+
+        std::cout << sprite_count << "\t" << submitted_changes << "\t\t\t" << count_texture_changes(sorted_textures)
+                  << "\t\t" << radix_cost / BENCH_QUEUE_REPEATS << "\t\t" << stable_cost / BENCH_QUEUE_REPEATS
+                  << "\t\t\t" << (same_order ? "yes" : "NO") << '\n';
+    }
+}
+
+void run_culling_benchmark()
+{
+    std::cout << "platforms\tvisible\tindex us/frame\tlinear us/frame\tsame result\n";
+
+    std::mt19937 random(3113);
+    for (int platform_count : BENCH_CULL_COUNTS)
+    {
+        // A long side-scrolling level, a few platforms deep
+        float level_width = platform_count * BENCH_CULL_SPACING;
+        std::uniform_real_distribution<float> height(-3.0f, 3.0f), width(1.0f, 3.0f);
+
+        std::vector<AABB> bounds(platform_count);
+        VisibilityIndex index;
+        for (int i = 0; i < platform_count; i++)
+        {
+            glm::vec2 position = glm::vec2(i * BENCH_CULL_SPACING, height(random));
+            Transform2D transform = Transform2D::make(position, 0.0f, glm::vec3(0.0f, 0.0f, 1.0f),
+                                                      glm::vec2(width(random), 0.5f));
+
+            bounds[i] = SpriteBatch::get_quad_bounds(transform);
+            index.add(bounds[i]);
+        }
+        index.build();
+
+        Camera camera(5.0f, 3.75f);
+        camera.set_limits({ -5.0f, -3.75f, level_width, 3.75f });
+
+        std::vector<VisibilityIndex::Range> ranges;
+        std::vector<int> linear_hits;
+        double index_cost = 0.0, linear_cost = 0.0;
+        long visible_total = 0;
+        bool same_result = true;
+        for (int frame = 0; frame < BENCH_CULL_FRAMES; frame++)
+        {
+            // The player runs from one end of the level to the other
+            camera.follow(glm::vec2(level_width * frame / BENCH_CULL_FRAMES, 0.0f));
+            AABB view = camera.get_visible_bounds();
+
+            auto start = std::chrono::steady_clock::now();
+            index.query(view, ranges);
+            auto middle = std::chrono::steady_clock::now();
+            linear_hits.clear();
+            for (int i = 0; i < platform_count; i++)
+                if (bounds[i].overlaps(view)) linear_hits.push_back(i);
+            auto end = std::chrono::steady_clock::now();
+
+            index_cost  += std::chrono::duration<double, std::micro>(middle - start).count();
+            linear_cost += std::chrono::duration<double, std::micro>(end - middle).count();
+
+            // The hierarchy pads its queries, so it may keep a sprite the scan dropped,
+            // but never the other way round
+            size_t hit = 0;
+            for (const VisibilityIndex::Range &range : ranges)
+            {
+                for (int i = range.first; i < range.first + range.count; i++)
+                {
+                    if (hit < linear_hits.size() && linear_hits[hit] == i) hit++;
+                    visible_total++;
+                }
+            }
+            same_result &= hit == linear_hits.size();
+        }
+
+        std::cout << platform_count << "\t\t" << (double) visible_total / BENCH_CULL_FRAMES << "\t"
+                  << index_cost / BENCH_CULL_FRAMES << "\t\t" << linear_cost / BENCH_CULL_FRAMES << "\t\t"
+                  << (same_result ? "yes" : "NO") << '\n';
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/**
+ * Headless benchmarks, run from the command line instead of the game:
+ *
+ *     ./SDLSimple --bench-collision
+ *     ./SDLSimple --bench-bvh
+ *     ./SDLSimple --bench-overlap
+ *     ./SDLSimple --bench-timestep
+ *     ./SDLSimple --bench-sleep
+ *     ./SDLSimple --bench-replay
+ *     ./SDLSimple --bench-enemies
+ *     ./SDLSimple --bench-text       (counts allocations if compiled with BENCH_COUNT_ALLOCATIONS)
+ *     ./SDLSimple --bench-render-queue
+ *     ./SDLSimple --bench-culling
+ *
+ * and one that draws the game itself, offscreen, for a number of frames; it needs a
+ * build compiled with HEADLESS_EGL and linked against libEGL (see HeadlessContext.h),
+ * and takes the game's own --platforms and --no-atlas options as well:
+ *
+ *     ./SDLSimple --bench-render 600 [--hash-frames]
+ *
+ * The game's --profile-gpu works there too, and writes gpu_profile.log as it does
+ * in play.
+ */
+void run_collision_benchmark();
+void run_bvh_benchmark();
+void run_overlap_benchmark();
+bool run_timestep_benchmark(); // false if continuous mode strays from the shipped path
+void run_sleep_benchmark();
+void run_replay_benchmark();
+void run_enemy_benchmark();
+void run_text_benchmark();
+void run_render_queue_benchmark();
+void run_culling_benchmark();
+
+#endif // BENCHMARK_H
@@ -0,0 +1,37 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <vector>
+
+struct AABB
+{
+    float min_x, min_y,
+          max_x, max_y;
+
+    // Inclusive, so that touching boxes are still handed to the narrowphase
+    bool overlaps(const AABB &other) const
+    {
+        return min_x <= other.max_x && other.min_x <= max_x &&
+               min_y <= other.max_y && other.min_y <= max_y;
+    }
+
+    bool contains(const AABB &other) const
+    {
+        return min_x <= other.min_x && other.max_x <= max_x &&
+               min_y <= other.min_y && other.max_y <= max_y;
+    }
+};
+
+/**
+ * Something that can narrow a collidable array down to the indices whose
+ * bounds might overlap a query box. Results are sorted ascending and may
+ * contain boxes that do not actually overlap.
+ */
+class Broadphase
+{
+public:
+    virtual ~Broadphase() { }
+    virtual void query(const AABB &bounds, std::vector<int> &out) const = 0;
+};
+
+#endif // BROADPHASE_H
@@ -0,0 +1,77 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <cstring>
+#include "CachedLayer.h"
+#include "TextureImporter.h"
+
+bool const CachedLayer::is_supported()
+{
+    const char *extensions = (const char*) glGetString(GL_EXTENSIONS);
+    return extensions != NULL &&
+           strstr(extensions, "GL_EXT_framebuffer_object") != NULL &&
+           strstr(extensions, "GL_EXT_framebuffer_blit")   != NULL;
+}
+
+CachedLayer::CachedLayer(int x, int y, int width, int height) : m_x(x), m_y(y), m_width(width), m_height(height)
+{
+    // Nearest filtering and a 1:1 copy, so the screen gets exactly the pixels drawn
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenFramebuffersEXT(1, &m_framebuffer);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, m_framebuffer);
+    glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, m_texture, 0);
+    if (glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) != GL_FRAMEBUFFER_COMPLETE_EXT)
+        std::cout << "Cached layer: framebuffer is incomplete\n";
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+
+    TextureImporter::record("cached layer", m_texture, m_width, m_height, TEXTURE_RGBA, false);
+}
+
+CachedLayer::~CachedLayer()
+{
+    TextureImporter::forget(m_texture);
+    glDeleteFramebuffersEXT(1, &m_framebuffer);
+    glDeleteTextures(1, &m_texture);
+}
+
+void CachedLayer::follow(glm::vec2 camera_position)
+{
+    if (camera_position == m_camera_position) return;
+
+    m_camera_position = camera_position;
+    m_is_valid        = false;
+}
+
+void CachedLayer::begin_capture()
+{
+    glGetIntegerv(GL_VIEWPORT, m_previous_viewport);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, m_framebuffer);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void CachedLayer::end_capture()
+{
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+    glViewport(m_previous_viewport[0], m_previous_viewport[1], m_previous_viewport[2], m_previous_viewport[3]);
+
+    m_is_valid = true;
+    m_capture_count++;
+}
+
+void CachedLayer::blit() const
+{
+    glBindFramebufferEXT(GL_READ_FRAMEBUFFER_EXT, m_framebuffer);
+    glBindFramebufferEXT(GL_DRAW_FRAMEBUFFER_EXT, 0);
+    glBlitFramebufferEXT(0, 0, m_width, m_height, m_x, m_y, m_x + m_width, m_y + m_height,
+                         GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+}
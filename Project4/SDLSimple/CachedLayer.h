@@ -0,0 +1,57 @@
+#ifndef CACHED_LAYER_H
+#define CACHED_LAYER_H
+
+#include "glm/glm.hpp"
+#include "ShaderProgram.h"
+
+/**
+ * Content that rarely changes, drawn once into an offscreen texture through a
+ * framebuffer object and then copied to the screen each frame with one opaque blit,
+ * in place of drawing and blending all of it again. The copy is only drawn again
+ * after the camera moves or the layer is invalidated, so the content must be opaque
+ * across the whole viewport and must only depend on the camera.
+ */
+class CachedLayer
+{
+private:
+    GLuint m_framebuffer = 0,
+           m_texture     = 0;
+
+    int m_x, m_y,
+        m_width, m_height;
+
+    glm::vec2 m_camera_position = glm::vec2(0.0f);
+    bool      m_is_valid        = false;
+
+    GLint m_previous_viewport[4];
+
+    // ————— STATISTICS ————— //
+    int m_capture_count = 0;
+
+public:
+    // ————— METHODS ————— //
+    // Framebuffer objects and blits are core from GL 3.0; on the 2.1 context both come
+    // from EXT extensions
+    static bool const is_supported();
+
+    // The layer covers the viewport at x, y, width x height
+    CachedLayer(int x, int y, int width, int height);
+    ~CachedLayer();
+
+    // The layer is drawn for one camera position, so moving it invalidates the layer
+    void follow(glm::vec2 camera_position);
+    void invalidate() { m_is_valid = false; }
+
+    // Draws in between go to the layer instead of the screen
+    void begin_capture();
+    void end_capture();
+
+    // Copies the layer over the viewport, replacing what was there
+    void blit() const;
+
+    // ————— GETTERS ————— //
+    bool const is_valid()          const { return m_is_valid;      }
+    int  const get_capture_count() const { return m_capture_count; }
+};
+
+#endif // CACHED_LAYER_H
@@ -0,0 +1,36 @@
+#include "Camera.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+// Where along one axis the view's centre may go to keep [centre - half, centre + half]
+// inside [low, high]
+static float clamp_axis(float centre, float half, float low, float high)
+{
+    if (high - low <= half * 2.0f) return (low + high) * 0.5f;
+    return glm::clamp(centre, low + half, high - half);
+}
+
+Camera::Camera(float half_width, float half_height)
+    : m_half_extents(half_width, half_height),
+      m_limits({ -half_width, -half_height, half_width, half_height }) { }
+
+void Camera::follow(glm::vec2 target)
+{
+    m_position.x = clamp_axis(target.x, m_half_extents.x, m_limits.min_x, m_limits.max_x);
+    m_position.y = clamp_axis(target.y, m_half_extents.y, m_limits.min_y, m_limits.max_y);
+}
+
+glm::mat4 const Camera::get_view_matrix() const
+{
+    return glm::translate(glm::mat4(1.0f), glm::vec3(-m_position, 0.0f));
+}
+
+glm::mat4 const Camera::get_projection_matrix() const
+{
+    return glm::ortho(-m_half_extents.x, m_half_extents.x, -m_half_extents.y, m_half_extents.y, -1.0f, 1.0f);
+}
+
+AABB const Camera::get_visible_bounds() const
+{
+    return { m_position.x - m_half_extents.x, m_position.y - m_half_extents.y,
+             m_position.x + m_half_extents.x, m_position.y + m_half_extents.y };
+}
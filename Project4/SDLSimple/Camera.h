@@ -0,0 +1,40 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "glm/glm.hpp"
+#include "Broadphase.h"
+
+/**
+ * An orthographic 2D camera that follows a target inside the level's limits. The
+ * view never shows anything past the limits; along an axis where the level is
+ * smaller than the view, the camera stays centred on the level instead.
+ */
+class Camera
+{
+private:
+    glm::vec2 m_position = glm::vec2(0.0f);
+    glm::vec2 m_half_extents;
+    AABB      m_limits;
+
+public:
+    // ————— METHODS ————— //
+    Camera(float half_width, float half_height);
+
+    // Centres the view on target, as far as the limits allow
+    void follow(glm::vec2 target);
+
+    glm::mat4 const get_view_matrix() const;
+    glm::mat4 const get_projection_matrix() const;
+
+    // The world-space rectangle the view currently shows
+    AABB const get_visible_bounds() const;
+
+    // ————— GETTERS ————— //
+    glm::vec2 const get_position()     const { return m_position;     }
+    glm::vec2 const get_half_extents() const { return m_half_extents; }
+
+    // ————— SETTERS ————— //
+    void const set_limits(const AABB &new_limits) { m_limits = new_limits; follow(m_position); }
+};
+
+#endif // CAMERA_H
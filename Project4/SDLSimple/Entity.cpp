@@ -18,12 +18,14 @@
 #define GL_GLEXT_PROTOTYPES 1
 #include <SDL.h>
 #include <SDL_opengl.h>
+#include <algorithm>
+#include <cmath>
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
 #include "Entity.h"
 
-void Entity::ai_activate(Entity *player)
+void Entity::ai_activate(const PlayerSnapshot &player)
 {
     switch (m_ai_type)
     {
@@ -40,17 +42,25 @@ void Entity::ai_activate(Entity *player)
     }
 }
 
+// Sleeping enemies are not updated, so only a state whose exit the world can wake them
+// for may sleep: an idle guard waits on the player coming within AI_WAKE_RADIUS. The
+// jumper's and patroller's states run on timers or on where the player is in the level.
+bool const Entity::ai_can_sleep() const
+{
+    return m_ai_type == GUARD && m_ai_state == IDLE;
+}
+
 void Entity::ai_walk()
 {
     m_movement = glm::vec3(-1.0f, 0.0f, 0.0f);
 }
 
 
-void Entity::ai_guard(Entity *player)
+void Entity::ai_guard(const PlayerSnapshot &player)
 {
     switch (m_ai_state) {
         case IDLE:
-            if (glm::distance(m_position, player->get_position()) < 3.0f){
+            if (glm::distance(get_position(), player.position) < AI_WAKE_RADIUS){
                 m_ai_state = WALKING;
             }
             
@@ -58,7 +68,7 @@ void Entity::ai_guard(Entity *player)
 
         case WALKING:
             /*
-            if (m_position.x > player->get_position().x) {
+            if (get_position().x > player.position.x) {
                 m_movement = glm::vec3(-1.0f, 0.0f, 0.0f);
             } else {
                 m_movement = glm::vec3(1.0f, 0.0f, 0.0f);
@@ -79,28 +89,28 @@ void Entity::ai_guard(Entity *player)
     }
 }
 
-void Entity::ai_jump(Entity *player)
+void Entity::ai_jump(const PlayerSnapshot &player)
 {
     switch (m_ai_state) {
         case IDLE:
-            if (player->get_position().y > 0.0f){
+            if (player.position.y > 0.0f){
                 m_ai_state = JUMPING;
             }
             
             break;
 
         case JUMPING:
-            ++m_jumping_counter;
+            m_jumping_counter += m_ai_ticks;
             if(m_jumping_counter > 70){
                 m_is_jumping = true;
             }
             if (m_is_jumping)
             {
                 m_is_jumping = false;
-                m_velocity.y += 4.0f;
+                world()->set_velocity_y(body(), get_velocity().y + 4.0f);
                 m_jumping_counter = 0;
             }
-            if((player->get_position()).x > 2.0f && (player->get_position()).y > 1.0f){
+            if(player.position.x > 2.0f && player.position.y > 1.0f){
                 m_ai_state = GONE;
             }
             break;
@@ -114,26 +124,26 @@ void Entity::ai_jump(Entity *player)
     }
 }
 
-void Entity::ai_patrol(Entity *player){
+void Entity::ai_patrol(const PlayerSnapshot &player){
     switch (m_ai_state) {
         case RIGHTMOVING:
-            ++m_moving_counter;
+            m_moving_counter += m_ai_ticks;
             m_movement = glm::vec3(3.0f, 0.0f, 0.0f);
             if(m_moving_counter > 70){
                 m_ai_state = LEFTMOVING;
             }
-            if((player->get_position()).x < -1.2f && (player->get_position()).y > 0.4f){
+            if(player.position.x < -1.2f && player.position.y > 0.4f){
                 m_ai_state = GONE;
             }
             break;
        
         case LEFTMOVING:
-            --m_moving_counter;
+            m_moving_counter -= m_ai_ticks;
             m_movement = glm::vec3(-3.0f, 0.0f, 0.0f);
             if(m_moving_counter <= 0){
                 m_ai_state = RIGHTMOVING;
             }
-            if((player->get_position()).x < -1.2f && (player->get_position()).y > 0.4f){
+            if(player.position.x < -1.2f && player.position.y > 0.4f){
                 m_ai_state = GONE;
             }
             break;
@@ -145,57 +155,66 @@ void Entity::ai_patrol(Entity *player){
 }
 // Default constructor
 Entity::Entity()
-    : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
+    : m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f),
     m_speed(0.0f), m_animation_cols(0), m_animation_frames(0), m_animation_index(0),
     m_animation_rows(0), m_animation_indices(nullptr), m_animation_time(0.0f),
-    m_texture_id(0), m_velocity(0.0f), m_acceleration(0.0f), m_width(0.0f), m_height(0.0f)
+    m_texture_id(0)
 {
     // Initialize m_walking with zeros or any default value
-    for (int i = 0; i < SECONDS_PER_FRAME; ++i)
-        for (int j = 0; j < SECONDS_PER_FRAME; ++j) m_walking[i][j] = 0;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 3; ++j) m_walking[i][j] = 0;
 }
 
 // Parameterized constructor
 Entity::Entity(GLuint texture_id, float speed, glm::vec3 acceleration, float jump_power, int walking[4][3], float animation_time,
     int animation_frames, int animation_index, int animation_cols,
     int animation_rows, float width, float height, EntityType EntityType)
-    : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
-    m_speed(speed),m_acceleration(acceleration), m_jumping_power(jump_power), m_animation_cols(animation_cols),
+    : m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f),
+    m_speed(speed), m_jumping_power(jump_power), m_animation_cols(animation_cols),
     m_animation_frames(animation_frames), m_animation_index(animation_index),
     m_animation_rows(animation_rows), m_animation_indices(nullptr),
-    m_animation_time(animation_time), m_texture_id(texture_id), m_velocity(0.0f),
-    m_width(width), m_height(height), m_entity_type(EntityType)
+    m_animation_time(animation_time), m_texture_id(texture_id)
 {
     face_right();
     set_walking(walking);
+    set_acceleration(acceleration);
+    set_width(width);
+    set_height(height);
+    set_entity_type(EntityType);
 }
 
 
 // Simpler constructor for partial initialization
 Entity::Entity(GLuint texture_id, float speed,  float width, float height, EntityType EntityType)
-    : m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
+    : m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f),
     m_speed(speed), m_animation_cols(0), m_animation_frames(0), m_animation_index(0),
     m_animation_rows(0), m_animation_indices(nullptr), m_animation_time(0.0f),
-    m_texture_id(texture_id), m_velocity(0.0f), m_acceleration(0.0f), m_width(width), m_height(height),m_entity_type(EntityType)
+    m_texture_id(texture_id)
 {
     // Initialize m_walking with zeros or any default value
-    for (int i = 0; i < SECONDS_PER_FRAME; ++i)
-        for (int j = 0; j < SECONDS_PER_FRAME; ++j) m_walking[i][j] = 0;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 3; ++j) m_walking[i][j] = 0;
+    set_width(width);
+    set_height(height);
+    set_entity_type(EntityType);
 }
 // AI constructor
-Entity::Entity(GLuint texture_id, float speed, float width, float height, EntityType EntityType, AIType AIType, AIState AIState): m_position(0.0f), m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f), m_model_matrix(1.0f),
+Entity::Entity(GLuint texture_id, float speed, float width, float height, EntityType EntityType, AIType AIType, AIState AIState): m_movement(0.0f), m_scale(1.0f, 1.0f, 0.0f),
 m_speed(speed), m_animation_cols(0), m_animation_frames(0), m_animation_index(0),
 m_animation_rows(0), m_animation_indices(nullptr), m_animation_time(0.0f),
-m_texture_id(texture_id), m_velocity(0.0f), m_acceleration(0.0f), m_width(width), m_height(height),m_entity_type(EntityType), m_ai_type(AIType), m_ai_state(AIState)
+m_texture_id(texture_id), m_ai_type(AIType), m_ai_state(AIState)
 {
 // Initialize m_walking with zeros or any default value
-for (int i = 0; i < SECONDS_PER_FRAME; ++i)
-    for (int j = 0; j < SECONDS_PER_FRAME; ++j) m_walking[i][j] = 0;
+for (int i = 0; i < 4; ++i)
+    for (int j = 0; j < 3; ++j) m_walking[i][j] = 0;
+set_width(width);
+set_height(height);
+set_entity_type(EntityType);
 }
 
 Entity::~Entity() { }
 
-void Entity::draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint texture_id, int index)
+void const Entity::get_frame_uv(int index, glm::vec2 &uv_offset, glm::vec2 &uv_size) const
 {
     // Step 1: Calculate the UV location of the indexed frame
     float u_coord = (float)(index % m_animation_cols) / (float)m_animation_cols;
@@ -205,133 +224,72 @@ void Entity::draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint textu
     float width = 1.0f / (float)m_animation_cols;
     float height = 1.0f / (float)m_animation_rows;
 
-    // Step 3: Just as we have done before, match the texture coordinates to the vertices
-    float tex_coords[] =
-    {
-        u_coord, v_coord + height, u_coord + width, v_coord + height, u_coord + width, v_coord,
-        u_coord, v_coord + height, u_coord + width, v_coord, u_coord, v_coord
-    };
-
-    float vertices[] =
-    {
-        -0.5, -0.5, 0.5, -0.5,  0.5, 0.5,
-        -0.5, -0.5, 0.5,  0.5, -0.5, 0.5
-    };
-
-    // Step 4: And render
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->get_position_attribute());
-
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
-
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    // Step 3: And move it into wherever the sheet sits in its texture
+    uv_offset = m_uv_offset + glm::vec2(u_coord, v_coord) * m_uv_size;
+    uv_size   = glm::vec2(width, height) * m_uv_size;
 }
 
-bool const Entity::check_collision(Entity* other) const
+void Entity::draw_sprite_from_texture_atlas(RenderQueue* queue, uint8_t layer, GLuint texture_id, int index)
 {
+    glm::vec2 uv_offset, uv_size;
+    get_frame_uv(index, uv_offset, uv_size);
+    queue->submit_sprite(layer, texture_id, get_transform(), uv_offset, uv_size);
+}
 
-    float x_distance = fabs(m_position.x - other->m_position.x) - ((m_width + other->m_width) / 2.0f);
-    float y_distance = fabs(m_position.y - other->m_position.y) - ((m_height + other->m_height) / 2.0f);
-
-    return x_distance < 0.0f && y_distance < 0.0f;
+void const Entity::set_entity_type(EntityType new_entity_type)
+{
+    m_entity_type = new_entity_type;
+
+    // Platforms are static level geometry; players and enemies are stepped by the world
+    world()->set_flag(body(), PhysicsWorld::BODY_DYNAMIC, m_entity_type != PLATFORM);
+    world()->set_flag(body(), PhysicsWorld::BODY_HOSTILE, m_entity_type == ENEMY);
+    world()->set_layer(body(), m_entity_type == PLATFORM ? LAYER_LEVEL :
+                               m_entity_type == PLAYER   ? LAYER_PLAYER : LAYER_ENEMY);
+    world()->set_mask(body(), collision_mask());
 }
 
-void const Entity::check_collision_y(Entity *collidable_entities, int collidable_entity_count)
+// Everything stands on the level, and only the player collides with (and is hurt
+// by) enemies, unless it is hiding from them
+uint8_t const Entity::collision_mask() const
 {
-    for (int i = 0; i < collidable_entity_count; i++)
+    switch (m_entity_type)
     {
-        if(m_is_hiding && collidable_entities[i].get_entity_type() == ENEMY) {
-            return;
-        }
-        
-        Entity *collidable_entity = &collidable_entities[i];
-
-        if (check_collision(collidable_entity) && collidable_entity->get_is_active())
-        {
-            float y_distance = fabs(m_position.y - collidable_entity->m_position.y);
-            float y_overlap = fabs(y_distance - (m_height / 2.0f) - (collidable_entity->m_height / 2.0f));
-            if (m_velocity.y > 0)
-            {
-                m_position.y   -= y_overlap;
-                m_velocity.y    = 0;
-
-                // Collision!
-                m_collided_top  = true;
-                if(collidable_entities[i].get_entity_type() == ENEMY){
-                    m_collided_enemy = true;
-                }
-            } else if (m_velocity.y < 0)
-            {
-                m_position.y      += y_overlap;
-                m_velocity.y       = 0;
-
-                // Collision!
-                m_collided_bottom  = true;
-                if(collidable_entities[i].get_entity_type() == ENEMY){
-                    m_collided_enemy = true;
-                }
-            }
-        }
+        case PLAYER: return m_is_hiding ? LAYER_LEVEL : LAYER_LEVEL | LAYER_ENEMY;
+        case ENEMY:  return LAYER_LEVEL;
+        default:     return 0;
     }
 }
 
-void const Entity::check_collision_x(Entity *collidable_entities, int collidable_entity_count)
+bool const Entity::check_collision(Entity* other) const
 {
-    for (int i = 0; i < collidable_entity_count; i++)
-    {
-        if(m_is_hiding && collidable_entities[i].get_entity_type() == ENEMY) {
-            return;
-        }
-
-        Entity *collidable_entity = &collidable_entities[i];
+    return world()->check_overlap(body(), other->body());
+}
 
-        if (check_collision(collidable_entity) && collidable_entity->get_is_active() )
+void Entity::update_all(JobSystem *jobs, Entity *entities, int count, float delta_time,
+                        const PlayerSnapshot *player)
+{
+    jobs->parallel_for(count, JobSystem::DEFAULT_BATCH_SIZE, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
         {
-            float x_distance = fabs(m_position.x - collidable_entity->m_position.x);
-            float x_overlap = fabs(x_distance - (m_width / 2.0f) - (collidable_entity->m_width / 2.0f));
-            if (m_velocity.x > 0)
-            {
-                m_position.x     -= x_overlap;
-                m_velocity.x      = 0;
-
-                // Collision!
-                m_collided_right  = true;
-                if(collidable_entities[i].get_entity_type() == ENEMY){
-                    m_collided_enemy = true;
-                }
-
-            } else if (m_velocity.x < 0)
-            {
-                m_position.x    += x_overlap;
-                m_velocity.x     = 0;
-
-                // Collision!
-                m_collided_left  = true;
-                if(collidable_entities[i].get_entity_type() == ENEMY){
-                    m_collided_enemy = true;
-                }
-            }
+            if (!entities[i].get_is_active() || entities[i].get_is_sleeping()) continue;
+            entities[i].update(delta_time, player);
         }
-    }
+    });
 }
-void Entity::update(float delta_time, Entity *player, Entity *collidable_entities, Entity * enemies, int collidable_entity_count, int enemies_count)
-{
-    if (!m_is_active) return;
 
-    m_collided_top    = false;
-    m_collided_bottom = false;
-    m_collided_left   = false;
-    m_collided_right  = false;
-    m_collided_enemy = false;
+void Entity::update(float delta_time, const PlayerSnapshot *player)
+{
+    if (!get_is_active()) return;
 
     if (m_entity_type == ENEMY){
-        ai_activate(player);
+        // The AI counters were tuned at 60 updates a second, so advance them by the
+        // number of those ticks this update covers
+        m_ai_ticks = std::max(1, (int) roundf(delta_time * AI_TICK_RATE));
+
+        AIState previous_state = m_ai_state;
+        ai_activate(*player);
+        if (m_ai_state != previous_state || !ai_can_sleep()) world()->wake_body(body());
     }
 
     if (m_animation_indices != NULL)
@@ -354,113 +312,55 @@ void Entity::update(float delta_time, Entity *player, Entity *collidable_entitie
         }
     }
 
-    m_velocity.x = m_movement.x * m_speed;
-    m_velocity += m_acceleration * delta_time;
-
-    m_position.y += m_velocity.y * delta_time;
-    check_collision_y(collidable_entities, collidable_entity_count);
-    check_collision_y(enemies, enemies_count);
-
-    m_position.x += m_velocity.x * delta_time;
-    check_collision_x(collidable_entities, collidable_entity_count);
-    check_collision_x(enemies, enemies_count);
+    world()->set_velocity_x(body(), m_movement.x * m_speed);
 
     if (m_is_jumping)
     {
         m_is_jumping = false;
-        m_velocity.y += m_jumping_power;
+        world()->set_velocity_y(body(), get_velocity().y + m_jumping_power);
     }
-
-    m_model_matrix = glm::mat4(1.0f);
-    m_model_matrix = glm::translate(m_model_matrix, m_position);
-    m_model_matrix = glm::rotate(m_model_matrix, m_rotate_angle, m_rotate_vec);
-    m_model_matrix = glm::scale(m_model_matrix, m_scale);
 }
 
-void Entity::update(float delta_time, Entity *player, Entity *collidable_entities, int collidable_entity_count)
-{
-    if (!m_is_active) return;
-
-    m_collided_top    = false;
-    m_collided_bottom = false;
-    m_collided_left   = false;
-    m_collided_right  = false;
-    m_collided_enemy = false;
-
-    if (m_entity_type == ENEMY){
-        ai_activate(player);
-    }
-
-    if (m_animation_indices != NULL)
-    {
-        if (glm::length(m_movement) != 0)
-        {
-            m_animation_time += delta_time;
-            float frames_per_second = (float) 1 / SECONDS_PER_FRAME;
-
-            if (m_animation_time >= frames_per_second)
-            {
-                m_animation_time = 0.0f;
-                m_animation_index++;
-
-                if (m_animation_index >= m_animation_frames)
-                {
-                    m_animation_index = 0;
-                }
-            }
-        }
-    }
-
-    m_velocity.x = m_movement.x * m_speed;
-    m_velocity += m_acceleration * delta_time;
-
-    m_position.y += m_velocity.y * delta_time;
-    check_collision_y(collidable_entities, collidable_entity_count);
 
-    m_position.x += m_velocity.x * delta_time;
-    check_collision_x(collidable_entities, collidable_entity_count);
-
-    if (m_is_jumping)
+const Transform2D &Entity::get_transform()
+{
+    if (m_is_transform_dirty)
     {
-        m_is_jumping = false;
-        m_velocity.y += m_jumping_power;
+        m_transform.set_linear(m_rotate_angle, m_rotate_vec, glm::vec2(m_scale));
+        m_is_transform_dirty = false;
     }
 
-    m_model_matrix = glm::mat4(1.0f);
-    m_model_matrix = glm::translate(m_model_matrix, m_position);
-    m_model_matrix = glm::rotate(m_model_matrix, m_rotate_angle, m_rotate_vec);
-    m_model_matrix = glm::scale(m_model_matrix, m_scale);
+    // The body moves under the world's control, so its position is copied in every
+    // time; that is two stores, against a sine, a cosine and a normalise above
+    m_transform.set_translation(world()->get_position(body()));
+    return m_transform;
 }
 
-
-void Entity::render(ShaderProgram* program)
+bool Entity::get_sprite_state(SpriteState &state)
 {
-    if (!m_is_active) return;
-    
-    program->set_model_matrix(m_model_matrix);
+    if (!get_is_active()) return false;
+
+    state.texture_id = m_texture_id;
+    state.transform  = get_transform();
 
     if (m_animation_indices != NULL){
-        if(m_is_hiding){
-            draw_sprite_from_texture_atlas(program, m_texture_id, 1);
-            return;
+        if(get_isHide()){
+            get_frame_uv(1, state.uv_offset, state.uv_size);
         }else {
-            draw_sprite_from_texture_atlas(program, m_texture_id, m_animation_indices[m_animation_index]);
-            return;
+            get_frame_uv(m_animation_indices[m_animation_index], state.uv_offset, state.uv_size);
         }
+        return true;
     }
 
-    float vertices[] = { -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, -0.5, 0.5, 0.5, -0.5, 0.5 };
-    float tex_coords[] = { 0.0,  1.0, 1.0,  1.0, 1.0, 0.0,  0.0,  1.0, 1.0, 0.0,  0.0, 0.0 };
-
-    glBindTexture(GL_TEXTURE_2D, m_texture_id);
-
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->get_position_attribute());
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
+    state.uv_offset = m_uv_offset;
+    state.uv_size   = m_uv_size;
+    return true;
+}
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+void Entity::render(RenderQueue* queue, uint8_t layer)
+{
+    SpriteState state;
+    if (!get_sprite_state(state)) return;
 
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    queue->submit_sprite(layer, state.texture_id, state.transform, state.uv_offset, state.uv_size);
 }
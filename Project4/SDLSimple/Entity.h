@@ -3,10 +3,38 @@
 
 #include "glm/glm.hpp"
 #include "ShaderProgram.h"
+#include "RenderQueue.h"
+#include "TextureAtlas.h"
+#include "Transform2D.h"
+#include "PhysicsWorld.h"
+#include "JobSystem.h"
 enum EntityType { PLATFORM, PLAYER, ENEMY  };
 enum AIType     { GUARD, JUMPER, PATROLLING         };
 enum AIState    { WALKING, IDLE, GONE, JUMPING, LEFTMOVING, RIGHTMOVING };
 
+// All an enemy's AI reads of the player, copied once per step so that enemies can be
+// updated in parallel while the player itself is updated
+struct PlayerSnapshot
+{
+    glm::vec3 position;
+};
+
+// Everything needed to draw an entity, copied out so it can be drawn on another thread
+struct SpriteState
+{
+    GLuint      texture_id;
+    glm::vec2   uv_offset, uv_size;
+    Transform2D transform;
+};
+
+// Collision layers; a body's mask lists the layers it is pushed out of
+enum CollisionLayer : uint8_t
+{
+    LAYER_LEVEL  = 1 << 0,
+    LAYER_PLAYER = 1 << 1,
+    LAYER_ENEMY  = 1 << 2
+};
+
 
 constexpr int LEFT  = 3,
               RIGHT = 1,
@@ -18,34 +46,39 @@ constexpr int LEFT  = 3,
 class Entity
 {
 private:
-    bool m_is_active = true;
-
     int m_walking[4][3]; // 4x4 array for walking animations
 
 
-    EntityType m_entity_type;
+    EntityType m_entity_type = PLATFORM;
     AIType     m_ai_type;
     AIState    m_ai_state;
+    // ————— PHYSICS ————— //
+    // Position, velocity, acceleration, size, collisions and the active and hiding
+    // states all live in the PhysicsWorld
+    PhysicsBody m_body;
+
     // ————— TRANSFORMATIONS ————— //
     glm::vec3 m_movement;
-    glm::vec3 m_position;
     glm::vec3 m_scale;
     glm::vec3 m_rotate_vec = glm::vec3(0.0f, 1.0f, 0.0f);
-    glm::vec3 m_velocity;
-    glm::vec3 m_acceleration;
 
-    glm::mat4 m_model_matrix;
+    // The rotation and scale part is only worked out again, when next asked for,
+    // after one of them has been set
+    Transform2D m_transform;
+    bool        m_is_transform_dirty = true;
 
     float m_rotate_angle = 0;
     
     float     m_speed,
               m_jumping_power;
 
-    bool m_is_jumping;
-    bool m_is_hiding;
+    bool m_is_jumping = false;
+    bool m_is_hiding  = false;
 
     // ————— TEXTURES ————— //
     GLuint    m_texture_id;
+    glm::vec2 m_uv_offset = glm::vec2(0.0f), // the part of the texture that is this entity's image
+              m_uv_size   = glm::vec2(1.0f);
 
     // ————— ANIMATION ————— //
     int m_animation_cols;
@@ -57,21 +90,22 @@ private:
     
     int m_moving_counter = 0;
 
+    int m_ai_ticks = 1; // AI_TICK_RATE ticks covered by the current update
+
     int* m_animation_indices = nullptr;
     float m_animation_time = 0.0f;
 
-    float m_width = 1.0f,
-          m_height = 1.0f;
-    // ————— COLLISIONS ————— //
-    bool m_collided_top    = false;
-    bool m_collided_bottom = false;
-    bool m_collided_left   = false;
-    bool m_collided_right  = false;
-    bool m_collided_enemy = false;
+    // The part of the texture showing animation frame index
+    void const get_frame_uv(int index, glm::vec2 &uv_offset, glm::vec2 &uv_size) const;
+
+    PhysicsWorld* const world() const { return m_body.get_world(); }
+    int           const body()  const { return m_body.get_index(); }
 
 public:
     // ————— STATIC VARIABLES ————— //
     static constexpr int SECONDS_PER_FRAME = 4;
+    static constexpr float AI_TICK_RATE = 60.0f;
+    static constexpr float AI_WAKE_RADIUS = 3.0f; // how close the player gets before a guard notices
 
     // ————— METHODS ————— //
     Entity();
@@ -82,20 +116,31 @@ public:
     Entity(GLuint texture_id, float speed, float width, float height, EntityType EntityType, AIType AIType, AIState AIState); // AI constructor
     ~Entity();
 
-    void draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint texture_id, int index);
+    void draw_sprite_from_texture_atlas(RenderQueue* queue, uint8_t layer, GLuint texture_id, int index);
     bool const check_collision(Entity* other) const;
 
-    void const check_collision_y(Entity* collidable_entities, int collidable_entity_count);
-    void const check_collision_x(Entity* collidable_entities, int collidable_entity_count);
-    void update(float delta_time, Entity *player, Entity *collidable_entities, int collidable_entity_count);
-    void update(float delta_time, Entity *player, Entity *collidable_entities, Entity * enemies, int collidable_entity_count, int enemies_count);
-    void render(ShaderProgram* program);
-
-    void ai_activate(Entity *player);
+    // Runs AI and animation and hands this step's velocity to the body; the
+    // movement itself happens when the world is stepped
+    // Enemies need the player's snapshot for their AI; everything else passes NULL
+    void update(float delta_time, const PlayerSnapshot *player);
+
+    // Updates the active, awake entities of an array on the job system. Each only
+    // writes its own state and body, so the result does not depend on the threads.
+    static void update_all(JobSystem *jobs, Entity *entities, int count, float delta_time,
+                           const PlayerSnapshot *player);
+    // Submits this entity's sprite to queue, to be drawn with everything else on layer
+    void render(RenderQueue* queue, uint8_t layer);
+    // Fills state with what render() would submit; false for an inactive entity
+    bool get_sprite_state(SpriteState &state);
+    const Transform2D &get_transform();
+
+    void ai_activate(const PlayerSnapshot &player);
     void ai_walk();
-    void ai_guard(Entity *player);
-    void ai_jump(Entity *player);
-    void ai_patrol(Entity *player);
+    void ai_guard(const PlayerSnapshot &player);
+    void ai_jump(const PlayerSnapshot &player);
+    void ai_patrol(const PlayerSnapshot &player);
+    bool const ai_can_sleep() const;
+    uint8_t const collision_mask() const;
 
     void normalise_movement() { m_movement = glm::normalize(m_movement); }
 
@@ -108,7 +153,7 @@ public:
         int single_indice = m_walking[HIDE][0];
         m_animation_indices = {single_indice, single_indice, single_indice};
          */
-        m_is_hiding = true;
+        set_hiding();
     }
  
     void move_left() { m_movement.x = -1.0f; face_left(); }
@@ -124,41 +169,53 @@ public:
     AIType     const get_ai_type()        const { return m_ai_type;       };
     AIState    const get_ai_state()       const { return m_ai_state;      };
     // General
-    glm::vec3 const get_position()     const { return m_position; }
-    glm::vec3 const get_velocity()     const { return m_velocity; }
-    glm::vec3 const get_acceleration() const { return m_acceleration; }
+    glm::vec3 const get_position()     const { return glm::vec3(world()->get_position(body()), 0.0f); }
+    glm::vec3 const get_velocity()     const { return glm::vec3(world()->get_velocity(body()), 0.0f); }
+    glm::vec3 const get_acceleration() const { return glm::vec3(world()->get_acceleration(body()), 0.0f); }
     glm::vec3 const get_movement()     const { return m_movement; }
     glm::vec3 const get_scale()        const { return m_scale; }
     float const get_rotate_angle() const {return m_rotate_angle;     }
     GLuint    const get_texture_id()   const { return m_texture_id; }
+    glm::vec2 const get_uv_offset()    const { return m_uv_offset; }
+    glm::vec2 const get_uv_size()      const { return m_uv_size; }
     float     const get_speed()        const { return m_speed; }
-    bool      const get_isHide()       const {return m_is_hiding; }
-    bool      const get_collided_top() const { return m_collided_top; }
-    bool      const get_collided_bottom() const { return m_collided_bottom; }
-    bool      const get_collided_right() const { return m_collided_right; }
-    bool      const get_collided_left() const { return m_collided_left; }
-    bool      const get_collided_enemy() const { return m_collided_enemy; }
-    float get_width() const { return m_width; }
-    float get_height() const { return m_height; }
-
-    bool get_is_active() { return m_is_active; }
-    void activate()   { m_is_active = true;  };
-    void deactivate() { m_is_active = false; };
+    bool      const get_isHide()       const { return m_is_hiding; }
+    bool      const get_collided_top() const { return world()->has_contact(body(), PhysicsWorld::CONTACT_TOP); }
+    bool      const get_collided_bottom() const { return world()->has_contact(body(), PhysicsWorld::CONTACT_BOTTOM); }
+    bool      const get_collided_right() const { return world()->has_contact(body(), PhysicsWorld::CONTACT_RIGHT); }
+    bool      const get_collided_left() const { return world()->has_contact(body(), PhysicsWorld::CONTACT_LEFT); }
+    bool      const get_collided_enemy() const { return world()->has_contact(body(), PhysicsWorld::CONTACT_HOSTILE); }
+    float get_width() const { return world()->get_half_width(body()) * 2.0f; }
+    float get_height() const { return world()->get_half_height(body()) * 2.0f; }
+    AABB  const get_bounds() const { return world()->get_bounds(body()); }
+
+    bool get_is_active() { return world()->has_flag(body(), PhysicsWorld::BODY_ACTIVE); }
+    int  get_body_index() const { return body(); }
+    PlayerSnapshot const get_snapshot() const { return { get_position() }; }
+    bool get_is_sleeping() { return world()->has_flag(body(), PhysicsWorld::BODY_SLEEPING); }
+    void activate()   { world()->set_flag(body(), PhysicsWorld::BODY_ACTIVE, true);  };
+    void deactivate() { world()->set_flag(body(), PhysicsWorld::BODY_ACTIVE, false); };
     // ————— SETTERS ————— //
     // AI
-    void const set_entity_type(EntityType new_entity_type)  { m_entity_type = new_entity_type;};
+    void const set_entity_type(EntityType new_entity_type);
     void const set_ai_type(AIType new_ai_type){ m_ai_type = new_ai_type;};
     void const set_ai_state(AIState new_state){ m_ai_state = new_state;};
     // General
-    void const set_position(glm::vec3 new_position) { m_position = new_position; }
-    void const set_position_y(float new_y) { m_position.y = new_y; }
-    void const set_velocity(glm::vec3 new_velocity) { m_velocity = new_velocity; }
-    void const set_acceleration(glm::vec3 new_acceleration) { m_acceleration = new_acceleration; }
+    void const set_position(glm::vec3 new_position) { world()->set_position(body(), glm::vec2(new_position)); }
+    void const set_position_y(float new_y) { world()->set_position_y(body(), new_y); }
+    void const set_velocity(glm::vec3 new_velocity) { world()->set_velocity(body(), glm::vec2(new_velocity)); }
+    void const set_acceleration(glm::vec3 new_acceleration) { world()->set_acceleration(body(), glm::vec2(new_acceleration)); }
     void const set_movement(glm::vec3 new_movement) { m_movement = new_movement; }
-    void const set_rotate_angle(float new_angle) { m_rotate_angle = new_angle; };
-    void const set_rotate_vector(glm::vec3 new_vec) { m_rotate_vec = new_vec; }
-    void const set_scale(glm::vec3 new_scale) { m_scale = new_scale; }
+    void const set_rotate_angle(float new_angle) { m_rotate_angle = new_angle; m_is_transform_dirty = true; };
+    void const set_rotate_vector(glm::vec3 new_vec) { m_rotate_vec = new_vec; m_is_transform_dirty = true; }
+    void const set_scale(glm::vec3 new_scale) { m_scale = new_scale; m_is_transform_dirty = true; }
     void const set_texture_id(GLuint new_texture_id) { m_texture_id = new_texture_id; }
+    void const set_texture_region(const AtlasRegion &new_region)
+    {
+        m_texture_id = new_region.texture_id;
+        m_uv_offset  = new_region.uv_offset;
+        m_uv_size    = new_region.uv_size;
+    }
     void const set_speed(float new_speed) { m_speed = new_speed; }
     void const set_animation_cols(int new_cols) { m_animation_cols = new_cols; }
     void const set_animation_rows(int new_rows) { m_animation_rows = new_rows; }
@@ -166,10 +223,10 @@ public:
     void const set_animation_index(int new_index) { m_animation_index = new_index; }
     void const set_animation_time(float new_time) { m_animation_time = new_time; }
     void const set_jumping_power(float new_jumping_power) { m_jumping_power = new_jumping_power;}
-    void const set_width(float new_width) {m_width = new_width; }
-    void const set_height(float new_height) {m_height = new_height; }
-    void const set_hiding() { m_is_hiding = true; }
-    void const set_un_hiding() { m_is_hiding = false; }
+    void const set_width(float new_width) { world()->set_half_width(body(), new_width / 2.0f); }
+    void const set_height(float new_height) { world()->set_half_height(body(), new_height / 2.0f); }
+    void const set_hiding() { m_is_hiding = true; world()->set_mask(body(), collision_mask()); }
+    void const set_un_hiding() { m_is_hiding = false; world()->set_mask(body(), collision_mask()); }
 
     // Setter for m_walking
     void set_walking(int walking[4][3])
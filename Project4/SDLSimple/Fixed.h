@@ -0,0 +1,58 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * A Q16.16 fixed-point number: 16 integer bits, 16 fraction bits, so values run
+ * from -32768 to just under 32768 in steps of 1/65536. Every operation is plain
+ * integer arithmetic, which gives the same bits on every CPU and compiler.
+ */
+struct Fixed
+{
+    static constexpr int     FRACTION_BITS = 16;
+    static constexpr int32_t ONE           = 1 << FRACTION_BITS;
+
+    int32_t raw;
+
+    constexpr Fixed() : raw(0) { }
+
+    // Rounds to the nearest step. Converting from float is exact and deterministic, so
+    // floats handed in from game code still give the same bits everywhere.
+    constexpr Fixed(float value)
+        : raw((int32_t) ((double) value * ONE + (value < 0.0f ? -0.5 : 0.5))) { }
+
+    static constexpr Fixed from_raw(int32_t raw) { Fixed fixed; fixed.raw = raw; return fixed; }
+
+    float const to_float() const { return (float) raw / ONE; }
+
+    // ————— ARITHMETIC ————— //
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return from_raw((int32_t) ((int64_t) a.raw + b.raw)); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return from_raw((int32_t) ((int64_t) a.raw - b.raw)); }
+    friend constexpr Fixed operator*(Fixed a, Fixed b) { return from_raw((int32_t) (((int64_t) a.raw * b.raw) >> FRACTION_BITS)); }
+    friend constexpr Fixed operator/(Fixed a, Fixed b) { return from_raw((int32_t) (((int64_t) a.raw * ONE) / b.raw)); }
+    constexpr Fixed operator-() const { return from_raw(-raw); }
+
+    Fixed& operator+=(Fixed other) { return *this = *this + other; }
+    Fixed& operator-=(Fixed other) { return *this = *this - other; }
+    Fixed& operator*=(Fixed other) { return *this = *this * other; }
+
+    // ————— COMPARISON ————— //
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+    friend constexpr bool operator< (Fixed a, Fixed b) { return a.raw <  b.raw; }
+    friend constexpr bool operator> (Fixed a, Fixed b) { return a.raw >  b.raw; }
+    friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+    friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+};
+
+inline Fixed fabs(Fixed value)      { return value.raw < 0 ? -value : value; }
+inline float to_float(Fixed value)  { return value.to_float(); }
+inline float to_float(float value)  { return value; }
+
+// The next representable value above (direction > 0) or below value
+inline Fixed next_toward(Fixed value, float direction) { return Fixed::from_raw(value.raw + (direction > 0.0f ? 1 : -1)); }
+inline float next_toward(float value, float direction) { return nextafterf(value, direction > 0.0f ? INFINITY : -INFINITY); }
+
+#endif // FIXED_H
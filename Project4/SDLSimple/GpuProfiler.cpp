@@ -0,0 +1,131 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <cstring>
+#include "GpuProfiler.h"
+
+constexpr double NANOSECONDS_PER_MILLISECOND = 1000000.0;
+
+GpuProfiler::~GpuProfiler()
+{
+    if (!m_is_supported) return;
+    for (FrameQueries &frame : m_frames) glDeleteQueries(MAX_PASSES, frame.queries);
+}
+
+bool GpuProfiler::init()
+{
+    // A 2.1 context only has timer queries as an extension; the EXT one is what
+    // macOS offers, and everything with the ARB one has it too
+    const char *extensions = (const char*) glGetString(GL_EXTENSIONS);
+    m_is_supported = extensions != NULL && (strstr(extensions, "GL_EXT_timer_query") != NULL ||
+                                            strstr(extensions, "GL_ARB_timer_query") != NULL);
+    if (!m_is_supported)
+    {
+        std::cout << "GPU profiler: this context has no timer queries\n";
+        return false;
+    }
+
+    for (FrameQueries &frame : m_frames) glGenQueries(MAX_PASSES, frame.queries);
+    return true;
+}
+
+bool GpuProfiler::open_log(const char *path)
+{
+    m_log.open(path);
+    if (!m_log) return false;
+
+    m_log << "frame";
+    for (int pass = 0; pass < MAX_PASSES; pass++)
+        if (m_pass_names[pass] != NULL) m_log << '\t' << m_pass_names[pass] << " ms";
+    m_log << '\n';
+    return true;
+}
+
+void GpuProfiler::resolve(FrameQueries &frame)
+{
+    frame.is_pending = false;
+
+    // Queries finish in the order they were issued, so once the last is in, all are
+    GLuint is_available = 0;
+    glGetQueryObjectuiv(frame.queries[frame.query_count - 1], GL_QUERY_RESULT_AVAILABLE, &is_available);
+    if (!is_available)
+    {
+        m_dropped_count++;
+        return;
+    }
+
+    for (double &ms : m_pass_ms) ms = 0.0;
+    for (int i = 0; i < frame.query_count; i++)
+    {
+        GLuint64EXT nanoseconds = 0;
+        glGetQueryObjectui64vEXT(frame.queries[i], GL_QUERY_RESULT, &nanoseconds);
+        m_pass_ms[frame.passes[i]] += nanoseconds / NANOSECONDS_PER_MILLISECOND;
+    }
+
+    for (int pass = 0; pass < MAX_PASSES; pass++) m_sum_ms[pass] += m_pass_ms[pass];
+    if (++m_resolved_count % AVERAGE_FRAMES == 0)
+    {
+        for (int pass = 0; pass < MAX_PASSES; pass++)
+        {
+            m_average_ms[pass] = m_sum_ms[pass] / AVERAGE_FRAMES;
+            m_sum_ms[pass]     = 0.0;
+        }
+    }
+
+    if (m_log.is_open())
+    {
+        m_log << frame.frame_number;
+        for (int pass = 0; pass < MAX_PASSES; pass++)
+            if (m_pass_names[pass] != NULL) m_log << '\t' << m_pass_ms[pass];
+        m_log << '\n';
+    }
+}
+
+void GpuProfiler::begin_frame()
+{
+    if (!m_is_supported) return;
+
+    // This set of queries was last used FRAME_LATENCY frames ago
+    FrameQueries &frame = m_frames[m_frame_index];
+    if (frame.is_pending) resolve(frame);
+
+    frame.query_count  = 0;
+    frame.frame_number = m_frame_count++;
+}
+
+void GpuProfiler::begin_pass(int pass)
+{
+    if (!m_is_supported) return;
+
+    end_pass();
+
+    FrameQueries &frame = m_frames[m_frame_index];
+    if (frame.query_count == MAX_PASSES) return;
+
+    frame.passes[frame.query_count] = pass;
+    glBeginQuery(GL_TIME_ELAPSED_EXT, frame.queries[frame.query_count++]);
+    m_is_pass_open = true;
+}
+
+void GpuProfiler::end_pass()
+{
+    if (!m_is_pass_open) return;
+
+    glEndQuery(GL_TIME_ELAPSED_EXT);
+    m_is_pass_open = false;
+}
+
+void GpuProfiler::end_frame()
+{
+    if (!m_is_supported) return;
+
+    end_pass();
+
+    FrameQueries &frame = m_frames[m_frame_index];
+    frame.is_pending = frame.query_count > 0;
+    m_frame_index = (m_frame_index + 1) % FRAME_LATENCY;
+}
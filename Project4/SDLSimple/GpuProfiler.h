@@ -0,0 +1,83 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <fstream>
+#include "ShaderProgram.h"
+
+/**
+ * Times named passes of a frame on the GPU with GL_TIME_ELAPSED queries. Each frame
+ * uses its own set of queries from a small pool, and is read back FRAME_LATENCY
+ * frames later, by which time the GPU has long finished it, so reading never waits.
+ * A frame whose results are somehow still not in is dropped rather than waited for.
+ *
+ * Passes are numbered by the caller and timed one after another; beginning a pass
+ * ends the one before it, as elapsed-time queries cannot overlap.
+ */
+class GpuProfiler
+{
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr int MAX_PASSES     = 16,
+                         FRAME_LATENCY  = 4,
+                         AVERAGE_FRAMES = 30; // frames read back per overlay average
+
+private:
+    // The queries one frame used, and which pass each timed
+    struct FrameQueries
+    {
+        GLuint queries[MAX_PASSES];
+        int    passes[MAX_PASSES];
+        int    query_count  = 0,
+               frame_number = 0;
+        bool   is_pending   = false;
+    };
+
+    bool m_is_supported = false;
+
+    FrameQueries m_frames[FRAME_LATENCY];
+    int          m_frame_index = 0,
+                 m_frame_count = 0;
+    bool         m_is_pass_open = false;
+
+    const char* m_pass_names[MAX_PASSES] = {};
+
+    // ————— RESULTS ————— //
+    double m_pass_ms[MAX_PASSES]    = {}, // the most recent frame read back
+           m_sum_ms[MAX_PASSES]     = {},
+           m_average_ms[MAX_PASSES] = {};
+    int    m_resolved_count = 0,
+           m_dropped_count  = 0;
+
+    std::ofstream m_log;
+
+    void resolve(FrameQueries &frame);
+
+public:
+    // ————— METHODS ————— //
+    ~GpuProfiler();
+
+    // Makes the query pool on the current context; false if it has no timer queries
+    bool init();
+
+    // Writes a line of pass times for every frame read back, after a header naming
+    // the passes, so every pass should be named first
+    bool open_log(const char *path);
+
+    void begin_frame();
+    void begin_pass(int pass);
+    void end_pass();
+    void end_frame();
+
+    // ————— GETTERS ————— //
+    bool        const is_supported()           const { return m_is_supported;     }
+    const char* const get_pass_name(int pass)  const { return m_pass_names[pass]; }
+    double      const get_pass_ms(int pass)    const { return m_pass_ms[pass];    }
+    double      const get_average_ms(int pass) const { return m_average_ms[pass]; }
+    int         const get_resolved_count()     const { return m_resolved_count;   }
+    int         const get_dropped_count()      const { return m_dropped_count;    }
+
+    // ————— SETTERS ————— //
+    void const set_pass_name(int pass, const char *new_name) { m_pass_names[pass] = new_name; }
+};
+
+#endif // GPU_PROFILER_H
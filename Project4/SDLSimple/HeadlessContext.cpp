@@ -0,0 +1,121 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include <iostream>
+#include <vector>
+#include "HeadlessContext.h"
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull,
+                   FNV_PRIME        = 0x100000001b3ull;
+
+HeadlessContext::~HeadlessContext()
+{
+    destroy();
+}
+
+#ifdef HEADLESS_EGL
+
+bool HeadlessContext::create(int width, int height)
+{
+    // Mesa's surfaceless platform needs no X or Wayland server; drivers without it
+    // fall back to whatever the default display is
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display != NULL)
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+    {
+        std::cout << "headless: no EGL display\n";
+        return false;
+    }
+
+    const EGLint config_attributes[] =
+    {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RED_SIZE,   8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    const EGLint surface_attributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+
+    EGLConfig config;
+    EGLint    config_count = 0;
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0 ||
+        !eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cout << "headless: no desktop GL config with a pbuffer\n";
+        eglTerminate(display);
+        return false;
+    }
+
+    // No attributes asks for a compatibility context, which is what the game's
+    // GL 2.1 code expects
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surface_attributes);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, surface, surface, context))
+    {
+        std::cout << "headless: could not make a context current\n";
+        if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+        eglTerminate(display);
+        return false;
+    }
+
+    m_display = display;
+    m_surface = surface;
+    m_context = context;
+    m_width   = width;
+    m_height  = height;
+
+    std::cout << "headless: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << '\n';
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if (m_display == nullptr) return;
+
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(m_display, m_context);
+    eglDestroySurface(m_display, m_surface);
+    eglTerminate(m_display);
+    m_display = m_surface = m_context = nullptr;
+}
+
+#else
+
+bool HeadlessContext::create(int, int)
+{
+    std::cout << "headless: this build has no EGL; compile with -DHEADLESS_EGL and link libEGL\n";
+    return false;
+}
+
+void HeadlessContext::destroy() { }
+
+#endif
+
+uint64_t const HeadlessContext::hash_framebuffer() const
+{
+    std::vector<unsigned char> pixels((size_t) m_width * m_height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (unsigned char byte : pixels) hash = (hash ^ byte) * FNV_PRIME;
+    return hash;
+}
@@ -0,0 +1,39 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <cstdint>
+
+/**
+ * A GL context with an offscreen pbuffer to draw into, for machines with no display,
+ * such as Linux build servers running Mesa's llvmpipe. It is made through EGL, so it
+ * only exists in builds compiled with HEADLESS_EGL and linked against libEGL and
+ * libGL; elsewhere create() reports that and fails.
+ */
+class HeadlessContext
+{
+private:
+    void *m_display = nullptr,
+         *m_surface = nullptr,
+         *m_context = nullptr;
+
+    int m_width  = 0,
+        m_height = 0;
+
+public:
+    // ————— METHODS ————— //
+    ~HeadlessContext();
+
+    // Makes a width x height context current on the calling thread
+    bool create(int width, int height);
+    void destroy();
+
+    // FNV-1a over the RGBA pixels drawn so far; the same scene gives the same hash
+    // on the same driver
+    uint64_t const hash_framebuffer() const;
+
+    // ————— GETTERS ————— //
+    int const get_width()  const { return m_width;  }
+    int const get_height() const { return m_height; }
+};
+
+#endif // HEADLESS_CONTEXT_H
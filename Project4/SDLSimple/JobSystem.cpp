@@ -0,0 +1,94 @@
+#include <algorithm>
+#include "JobSystem.h"
+
+JobSystem::JobSystem(int worker_count)
+{
+    if (worker_count < 0) worker_count = std::max(0, (int) std::thread::hardware_concurrency() - 1);
+
+    for (int i = 0; i < worker_count; i++) m_workers.emplace_back(&JobSystem::worker_loop, this);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_work_ready.notify_all();
+
+    for (std::thread &worker : m_workers) worker.join();
+}
+
+void JobSystem::run_batches(const Job *job, int count, int batch_size)
+{
+    if (job == nullptr) return;
+
+    int batch_count = (count + batch_size - 1) / batch_size;
+    for (int batch = m_next_batch++; batch < batch_count; batch = m_next_batch++)
+    {
+        int first = batch * batch_size;
+        (*job)(first, std::min(first + batch_size, count));
+    }
+}
+
+void JobSystem::worker_loop()
+{
+    unsigned generation = 0;
+
+    while (true)
+    {
+        // The job is copied under the lock, and counting this worker as busy keeps
+        // parallel_for from returning, and the job from changing, until it is done
+        const Job *job;
+        int count, batch_size;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_ready.wait(lock, [&] { return m_quit || m_generation != generation; });
+            if (m_quit) return;
+
+            generation = m_generation;
+            job        = m_job;
+            count      = m_count;
+            batch_size = m_batch_size;
+            m_busy_workers++;
+        }
+
+        run_batches(job, count, batch_size);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy_workers--;
+        }
+        m_work_done.notify_one();
+    }
+}
+
+void JobSystem::parallel_for(int count, int batch_size, const Job &job)
+{
+    if (count <= 0) return;
+
+    // Not worth waking anyone for a single batch
+    if (m_workers.empty() || count <= batch_size)
+    {
+        job(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job        = &job;
+        m_count      = count;
+        m_batch_size = batch_size;
+        m_next_batch = 0;
+        m_generation++;
+    }
+    m_work_ready.notify_all();
+
+    run_batches(&job, count, batch_size);
+
+    // A worker that wakes late finds no batches left, but still has to be waited
+    // for before the job it points at goes out of scope
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_work_done.wait(lock, [&] { return m_busy_workers == 0; });
+    m_job = nullptr;
+}
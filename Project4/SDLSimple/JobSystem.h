@@ -0,0 +1,56 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed pool of worker threads that split a range of indices into batches and
+ * run a job over each batch. The calling thread works through batches too, so a
+ * pool with no workers simply runs everything in order on the caller.
+ */
+class JobSystem
+{
+public:
+    typedef std::function<void(int first, int last)> Job; // handles [first, last)
+
+private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex              m_mutex;
+    std::condition_variable m_work_ready, m_work_done;
+
+    // ————— CURRENT JOB ————— //
+    const Job*       m_job        = nullptr;
+    int              m_count      = 0,
+                     m_batch_size = 1;
+    std::atomic<int> m_next_batch { 0 };
+    int              m_busy_workers = 0;
+    unsigned         m_generation   = 0; // bumped for every job so workers run each one once
+    bool             m_quit         = false;
+
+    void worker_loop();
+    void run_batches(const Job *job, int count, int batch_size);
+
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr int DEFAULT_BATCH_SIZE = 256;
+
+    // ————— METHODS ————— //
+    // -1 uses one worker per hardware thread beyond the caller's own
+    explicit JobSystem(int worker_count = -1);
+    ~JobSystem();
+
+    // Runs job over [0, count) and returns once every batch has finished. Batches may
+    // run in any order and on any thread, so a job must only write to its own indices.
+    void parallel_for(int count, int batch_size, const Job &job);
+
+    // ————— GETTERS ————— //
+    int const get_worker_count() const { return (int) m_workers.size(); }
+};
+
+#endif // JOB_SYSTEM_H
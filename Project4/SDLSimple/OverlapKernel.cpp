@@ -0,0 +1,191 @@
+#include <cmath>
+#include <cstring>
+#include "OverlapKernel.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+    #define OVERLAP_X86 1
+    #include <immintrin.h>
+// The NEON kernel's horizontal add only exists on AArch64; 32-bit ARM stays scalar
+#elif defined(__aarch64__)
+    #define OVERLAP_NEON_AVAILABLE 1
+    #include <arm_neon.h>
+#endif
+
+typedef void (*OverlapFunction)(float, float, float, float, const BoxArrays&, int, uint32_t*);
+
+// Sets the bits for boxes [first, count); the SIMD kernels use it for their tails
+static void overlap_scalar_from(float x, float y, float half_width, float half_height,
+                                const BoxArrays &boxes, int first, int count, uint32_t *mask)
+{
+    for (int i = first; i < count; i++)
+    {
+        float x_distance = fabs(x - boxes.x[i]) - (half_width  + boxes.half_width[i]);
+        float y_distance = fabs(y - boxes.y[i]) - (half_height + boxes.half_height[i]);
+
+        if (x_distance < 0.0f && y_distance < 0.0f) mask[i >> 5] |= 1u << (i & 31);
+    }
+}
+
+static void overlap_scalar(float x, float y, float half_width, float half_height,
+                           const BoxArrays &boxes, int count, uint32_t *mask)
+{
+    overlap_scalar_from(x, y, half_width, half_height, boxes, 0, count, mask);
+}
+
+#ifdef OVERLAP_X86
+static void overlap_sse(float x, float y, float half_width, float half_height,
+                        const BoxArrays &boxes, int count, uint32_t *mask)
+{
+    const __m128 sign_bits = _mm_set1_ps(-0.0f), zero = _mm_setzero_ps();
+    const __m128 mover_x = _mm_set1_ps(x),          mover_y = _mm_set1_ps(y),
+                 mover_w = _mm_set1_ps(half_width), mover_h = _mm_set1_ps(half_height);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x_distance = _mm_sub_ps(_mm_andnot_ps(sign_bits, _mm_sub_ps(mover_x, _mm_loadu_ps(boxes.x + i))),
+                                       _mm_add_ps(mover_w, _mm_loadu_ps(boxes.half_width + i)));
+        __m128 y_distance = _mm_sub_ps(_mm_andnot_ps(sign_bits, _mm_sub_ps(mover_y, _mm_loadu_ps(boxes.y + i))),
+                                       _mm_add_ps(mover_h, _mm_loadu_ps(boxes.half_height + i)));
+
+        __m128 overlap = _mm_and_ps(_mm_cmplt_ps(x_distance, zero), _mm_cmplt_ps(y_distance, zero));
+        uint32_t bits = (uint32_t) _mm_movemask_ps(overlap);
+
+        // i is a multiple of four, so the four bits never straddle a mask word
+        mask[i >> 5] |= bits << (i & 31);
+    }
+    overlap_scalar_from(x, y, half_width, half_height, boxes, i, count, mask);
+}
+
+__attribute__((target("avx2")))
+static void overlap_avx2(float x, float y, float half_width, float half_height,
+                         const BoxArrays &boxes, int count, uint32_t *mask)
+{
+    const __m256 sign_bits = _mm256_set1_ps(-0.0f), zero = _mm256_setzero_ps();
+    const __m256 mover_x = _mm256_set1_ps(x),          mover_y = _mm256_set1_ps(y),
+                 mover_w = _mm256_set1_ps(half_width), mover_h = _mm256_set1_ps(half_height);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x_distance = _mm256_sub_ps(_mm256_andnot_ps(sign_bits, _mm256_sub_ps(mover_x, _mm256_loadu_ps(boxes.x + i))),
+                                          _mm256_add_ps(mover_w, _mm256_loadu_ps(boxes.half_width + i)));
+        __m256 y_distance = _mm256_sub_ps(_mm256_andnot_ps(sign_bits, _mm256_sub_ps(mover_y, _mm256_loadu_ps(boxes.y + i))),
+                                          _mm256_add_ps(mover_h, _mm256_loadu_ps(boxes.half_height + i)));
+
+        __m256 overlap = _mm256_and_ps(_mm256_cmp_ps(x_distance, zero, _CMP_LT_OQ),
+                                       _mm256_cmp_ps(y_distance, zero, _CMP_LT_OQ));
+        uint32_t bits = (uint32_t) _mm256_movemask_ps(overlap);
+
+        mask[i >> 5] |= bits << (i & 31);
+    }
+    // The tail and the caller are plain SSE code, which stalls on every instruction while
+    // the upper halves of the ymm registers are dirty; the compiler does not clear them here
+    _mm256_zeroupper();
+    overlap_scalar_from(x, y, half_width, half_height, boxes, i, count, mask);
+}
+#endif
+
+#ifdef OVERLAP_NEON_AVAILABLE
+static void overlap_neon(float x, float y, float half_width, float half_height,
+                         const BoxArrays &boxes, int count, uint32_t *mask)
+{
+    const float32x4_t mover_x = vdupq_n_f32(x),          mover_y = vdupq_n_f32(y),
+                      mover_w = vdupq_n_f32(half_width), mover_h = vdupq_n_f32(half_height),
+                      zero    = vdupq_n_f32(0.0f);
+    const uint32x4_t  lane_bits = { 1, 2, 4, 8 };
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t x_distance = vsubq_f32(vabsq_f32(vsubq_f32(mover_x, vld1q_f32(boxes.x + i))),
+                                           vaddq_f32(mover_w, vld1q_f32(boxes.half_width + i)));
+        float32x4_t y_distance = vsubq_f32(vabsq_f32(vsubq_f32(mover_y, vld1q_f32(boxes.y + i))),
+                                           vaddq_f32(mover_h, vld1q_f32(boxes.half_height + i)));
+
+        uint32x4_t overlap = vandq_u32(vcltq_f32(x_distance, zero), vcltq_f32(y_distance, zero));
+        uint32_t bits = vaddvq_u32(vandq_u32(overlap, lane_bits));
+
+        mask[i >> 5] |= bits << (i & 31);
+    }
+    overlap_scalar_from(x, y, half_width, half_height, boxes, i, count, mask);
+}
+#endif
+
+static OverlapKernelType g_kernel_type;
+static OverlapFunction   g_kernel = nullptr;
+
+bool const is_overlap_kernel_supported(OverlapKernelType type)
+{
+    switch (type)
+    {
+        case OVERLAP_SCALAR:
+            return true;
+#ifdef OVERLAP_X86
+        case OVERLAP_SSE:
+            return __builtin_cpu_supports("sse2");
+        case OVERLAP_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef OVERLAP_NEON_AVAILABLE
+        case OVERLAP_NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+bool set_overlap_kernel(OverlapKernelType type)
+{
+    if (!is_overlap_kernel_supported(type)) return false;
+
+    switch (type)
+    {
+#ifdef OVERLAP_X86
+        case OVERLAP_SSE:  g_kernel = overlap_sse;  break;
+        case OVERLAP_AVX2: g_kernel = overlap_avx2; break;
+#endif
+#ifdef OVERLAP_NEON_AVAILABLE
+        case OVERLAP_NEON: g_kernel = overlap_neon; break;
+#endif
+        default:           g_kernel = overlap_scalar; break;
+    }
+    g_kernel_type = type;
+    return true;
+}
+
+OverlapKernelType const get_overlap_kernel()
+{
+    if (g_kernel == nullptr)
+    {
+        if (!set_overlap_kernel(OVERLAP_AVX2) && !set_overlap_kernel(OVERLAP_NEON) &&
+            !set_overlap_kernel(OVERLAP_SSE)) set_overlap_kernel(OVERLAP_SCALAR);
+    }
+    return g_kernel_type;
+}
+
+const char* get_overlap_kernel_name(OverlapKernelType type)
+{
+    switch (type)
+    {
+        case OVERLAP_SSE:  return "sse";
+        case OVERLAP_AVX2: return "avx2";
+        case OVERLAP_NEON: return "neon";
+        default:           return "scalar";
+    }
+}
+
+int const get_overlap_mask_words(int count)
+{
+    return (count + 31) / 32;
+}
+
+void overlap_mask(float x, float y, float half_width, float half_height,
+                  const BoxArrays &boxes, int count, uint32_t *mask)
+{
+    get_overlap_kernel();
+
+    memset(mask, 0, get_overlap_mask_words(count) * sizeof(uint32_t));
+    g_kernel(x, y, half_width, half_height, boxes, count, mask);
+}
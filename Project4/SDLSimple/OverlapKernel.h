@@ -0,0 +1,31 @@
+#ifndef OVERLAP_KERNEL_H
+#define OVERLAP_KERNEL_H
+
+#include <cstdint>
+
+enum OverlapKernelType { OVERLAP_SCALAR, OVERLAP_SSE, OVERLAP_AVX2, OVERLAP_NEON };
+
+// Boxes in structure-of-arrays form: centres and half-extents
+struct BoxArrays
+{
+    const float *x, *y,
+                *half_width, *half_height;
+};
+
+/**
+ * Tests one box against count boxes, 4 or 8 at a time where the CPU allows, using
+ * exactly the same arithmetic as PhysicsWorld::check_overlap. Bit i of
+ * mask[i / 32] is set when box i overlaps; mask must hold (count + 31) / 32 words.
+ */
+void overlap_mask(float x, float y, float half_width, float half_height,
+                  const BoxArrays &boxes, int count, uint32_t *mask);
+
+int const get_overlap_mask_words(int count);
+
+// The fastest kernel this CPU supports is picked on first use; forcing one is for benchmarks
+OverlapKernelType const get_overlap_kernel();
+bool set_overlap_kernel(OverlapKernelType type);
+bool const is_overlap_kernel_supported(OverlapKernelType type);
+const char* get_overlap_kernel_name(OverlapKernelType type);
+
+#endif // OVERLAP_KERNEL_H
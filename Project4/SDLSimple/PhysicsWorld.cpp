@@ -0,0 +1,610 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "PhysicsWorld.h"
+
+PhysicsWorld* PhysicsWorld::s_current = nullptr;
+
+// How far past a body's bounds its contact cache reaches. Walking speed covers
+// it in about five steps; standing still never leaves it.
+constexpr float CONTACT_CACHE_MARGIN = 0.25f;
+
+// Contains no box, so the next lookup misses
+constexpr AABB EMPTY_REGION = { 1.0f, 1.0f, 0.0f, 0.0f };
+
+// A body at rest for this many steps in a row falls asleep
+constexpr int SLEEP_STEPS = 30;
+
+// How far a body may already be sunk into a platform and still be swept onto it
+// rather than left to the discrete pushout
+constexpr Scalar SWEEP_TOLERANCE = 1.0e-3f;
+
+// The centre that leaves a body touching, but not overlapping, a box centred on
+// centre, on the given side. Rounding can leave centre - extent a hair inside the
+// box, which check_overlap would then report, so step outwards until it does not.
+static Scalar flush_position(Scalar centre, Scalar extent, float side)
+{
+    Scalar position = side > 0.0f ? centre + extent : centre - extent;
+    while (fabs(position - centre) - extent < 0.0f) position = next_toward(position, side);
+    return position;
+}
+
+PhysicsWorld::~PhysicsWorld()
+{
+    if (s_current == this) s_current = nullptr;
+}
+
+int PhysicsWorld::create_body()
+{
+    int body;
+    if (!m_free_bodies.empty())
+    {
+        body = m_free_bodies.back();
+        m_free_bodies.pop_back();
+    } else
+    {
+        body = (int) m_flags.size();
+        m_position_x.push_back(0.0f);     m_position_y.push_back(0.0f);
+        m_velocity_x.push_back(0.0f);     m_velocity_y.push_back(0.0f);
+        m_acceleration_x.push_back(0.0f); m_acceleration_y.push_back(0.0f);
+        m_half_width.push_back(0.0f);     m_half_height.push_back(0.0f);
+        m_flags.push_back(0);
+        m_layers.push_back(0);            m_masks.push_back(0);
+        m_contacts.push_back(0);
+        m_rest_steps.push_back(0);
+        m_cache_regions.push_back(EMPTY_REGION);
+        m_cached_statics.emplace_back();
+    }
+
+    m_position_x[body]     = m_position_y[body]     = 0.0f;
+    m_velocity_x[body]     = m_velocity_y[body]     = 0.0f;
+    m_acceleration_x[body] = m_acceleration_y[body] = 0.0f;
+    m_half_width[body]     = m_half_height[body]    = 0.0f;
+    m_flags[body]      = BODY_ACTIVE;
+    m_layers[body]     = m_masks[body] = 0;
+    m_contacts[body]   = 0;
+    m_rest_steps[body] = 0;
+    m_cache_regions[body] = EMPTY_REGION;
+
+    return body;
+}
+
+void PhysicsWorld::destroy_body(int body)
+{
+    set_flag(body, BODY_DYNAMIC, false);
+    m_flags[body] = 0;
+    m_free_bodies.push_back(body);
+}
+
+void PhysicsWorld::copy_body(int destination, int source)
+{
+    if (destination == source) return;
+
+    m_position_x[destination]     = m_position_x[source];
+    m_position_y[destination]     = m_position_y[source];
+    m_velocity_x[destination]     = m_velocity_x[source];
+    m_velocity_y[destination]     = m_velocity_y[source];
+    m_acceleration_x[destination] = m_acceleration_x[source];
+    m_acceleration_y[destination] = m_acceleration_y[source];
+    m_half_width[destination]     = m_half_width[source];
+    m_half_height[destination]    = m_half_height[source];
+    m_layers[destination]         = m_layers[source];
+    m_masks[destination]          = m_masks[source];
+    m_contacts[destination]       = m_contacts[source];
+    m_rest_steps[destination]     = m_rest_steps[source];
+    m_cache_regions[destination]  = m_cache_regions[source];
+    m_cached_statics[destination] = m_cached_statics[source];
+
+    set_flag(destination, BODY_DYNAMIC, has_flag(source, BODY_DYNAMIC));
+    m_flags[destination] = m_flags[source];
+}
+
+void PhysicsWorld::set_flag(int body, BodyFlag flag, bool value)
+{
+    if (has_flag(body, flag) == value) return;
+
+    if (flag == BODY_DYNAMIC)
+    {
+        if (value) m_dynamic_bodies.push_back(body);
+        else m_dynamic_bodies.erase(std::find(m_dynamic_bodies.begin(), m_dynamic_bodies.end(), body));
+    }
+
+    if (value) m_flags[body] |= flag;
+    else m_flags[body] &= ~flag;
+
+    if (flag == BODY_ACTIVE && value) wake_body(body);
+}
+
+void PhysicsWorld::wake_near(glm::vec2 position, float radius)
+{
+    for (int body : m_dynamic_bodies)
+        if (has_flag(body, BODY_SLEEPING) && glm::distance(get_position(body), position) < radius) wake_body(body);
+}
+
+void PhysicsWorld::wake_all()
+{
+    for (int body : m_dynamic_bodies) wake_body(body);
+}
+
+void PhysicsWorld::build_static_broadphase()
+{
+    m_static_bodies.clear();
+    for (int body = 0; body < (int) m_flags.size(); body++)
+        if (m_layers[body] != 0 && !has_flag(body, BODY_DYNAMIC)) m_static_bodies.push_back(body);
+
+    m_static_layers = 0;
+    for (int body : m_static_bodies) m_static_layers |= m_layers[body];
+
+    m_static_x.clear(); m_static_y.clear();
+    m_static_half_width.clear(); m_static_half_height.clear();
+    for (int body : m_static_bodies)
+    {
+        m_static_x.push_back(to_float(m_position_x[body]));
+        m_static_y.push_back(to_float(m_position_y[body]));
+        m_static_half_width.push_back(to_float(m_half_width[body]));
+        m_static_half_height.push_back(to_float(m_half_height[body]));
+    }
+
+    std::vector<AABB> bounds;
+    get_static_bounds(bounds);
+    m_static_bvh.build(bounds);
+    m_broadphase = &m_static_bvh;
+    invalidate_contact_caches();
+
+    // Whatever was resting on the old geometry may no longer be
+    wake_all();
+}
+
+void PhysicsWorld::get_static_bounds(std::vector<AABB> &out) const
+{
+    out.clear();
+    for (int body : m_static_bodies) out.push_back(get_bounds(body));
+}
+
+bool const PhysicsWorld::check_overlap(int body, int other) const
+{
+    Scalar x_distance = fabs(m_position_x[body] - m_position_x[other]) - (m_half_width[body] + m_half_width[other]);
+    Scalar y_distance = fabs(m_position_y[body] - m_position_y[other]) - (m_half_height[body] + m_half_height[other]);
+
+    return x_distance < 0.0f && y_distance < 0.0f;
+}
+
+void PhysicsWorld::step(float step_time)
+{
+    Scalar delta_time = step_time;
+
+    // Inactive and sleeping bodies are left out of every pass below
+    m_awake_bodies.clear();
+    m_sleeping_count = 0;
+    m_dynamic_layers = 0;
+    for (int body : m_dynamic_bodies)
+    {
+        if (!has_flag(body, BODY_ACTIVE)) continue;
+        m_dynamic_layers |= m_layers[body];
+        if (has_flag(body, BODY_SLEEPING)) m_sleeping_count++;
+        else m_awake_bodies.push_back(body);
+    }
+    m_awake_count = (int) m_awake_bodies.size();
+
+    for (int body : m_dynamic_bodies)
+        if (!has_flag(body, BODY_SLEEPING)) m_contacts[body] = 0;
+
+    // Integration touches nothing but the velocity and position arrays
+    for (int body : m_awake_bodies)
+    {
+        m_velocity_x[body] += m_acceleration_x[body] * delta_time;
+        m_velocity_y[body] += m_acceleration_y[body] * delta_time;
+    }
+
+    // Bodies pushed out of other dynamic bodies (the player) move first and one at a
+    // time, as Entity::update used to, so they meet the others where the last step
+    // left them rather than part way through this one
+    for (int body : m_awake_bodies)
+    {
+        if ((m_masks[body] & m_dynamic_layers) == 0) continue;
+
+        move_y(body, delta_time);
+        resolve_y(body);
+        move_x(body, delta_time);
+        resolve_x(body);
+    }
+
+    for (int body : m_awake_bodies)
+        if ((m_masks[body] & m_dynamic_layers) == 0) move_y(body, delta_time);
+    for (int body : m_awake_bodies)
+        if ((m_masks[body] & m_dynamic_layers) == 0) resolve_y(body);
+
+    for (int body : m_awake_bodies)
+        if ((m_masks[body] & m_dynamic_layers) == 0) move_x(body, delta_time);
+    for (int body : m_awake_bodies)
+        if ((m_masks[body] & m_dynamic_layers) == 0) resolve_x(body);
+
+    if (m_sleeping)
+        for (int body : m_awake_bodies) update_rest(body);
+}
+
+void PhysicsWorld::move_y(int body, Scalar delta_time)
+{
+    if (m_continuous) sweep_y(body, delta_time);
+    else m_position_y[body] += m_velocity_y[body] * delta_time;
+}
+
+void PhysicsWorld::move_x(int body, Scalar delta_time)
+{
+    if (m_continuous) sweep_x(body, delta_time);
+    else m_position_x[body] += m_velocity_x[body] * delta_time;
+}
+
+// Bodies whose mask takes in other dynamic bodies stay awake, since those can walk
+// into them while they are still
+void PhysicsWorld::update_rest(int body)
+{
+    if (m_velocity_x[body] != 0.0f || m_velocity_y[body] != 0.0f || (m_masks[body] & m_dynamic_layers) != 0)
+    {
+        m_rest_steps[body] = 0;
+        return;
+    }
+
+    if (++m_rest_steps[body] >= SLEEP_STEPS) m_flags[body] |= BODY_SLEEPING;
+}
+
+void PhysicsWorld::gather_static(int body, const AABB &bounds, std::vector<int> &out)
+{
+    if (m_broadphase != nullptr)
+    {
+        cached_static(body, bounds, out);
+        return;
+    }
+
+    out.clear();
+    for (int index = 0; index < (int) m_static_bodies.size(); index++) out.push_back(index);
+}
+
+// The cached list is a sorted superset of what the broadphase would return for
+// bounds, and the narrowphase drops the rest, so resolution order is unchanged.
+void PhysicsWorld::cached_static(int body, const AABB &bounds, std::vector<int> &out)
+{
+    if (!m_contact_caching)
+    {
+        m_broadphase->query(bounds, out);
+        return;
+    }
+
+    if (m_cache_regions[body].contains(bounds))
+    {
+        m_cache_hits++;
+    } else
+    {
+        m_cache_misses++;
+        m_cache_regions[body] = { bounds.min_x - CONTACT_CACHE_MARGIN, bounds.min_y - CONTACT_CACHE_MARGIN,
+                                  bounds.max_x + CONTACT_CACHE_MARGIN, bounds.max_y + CONTACT_CACHE_MARGIN };
+        m_broadphase->query(m_cache_regions[body], m_cached_statics[body]);
+    }
+    out = m_cached_statics[body];
+}
+
+void PhysicsWorld::invalidate_contact_caches()
+{
+    std::fill(m_cache_regions.begin(), m_cache_regions.end(), EMPTY_REGION);
+}
+
+// Moves the body along y until its leading edge reaches the nearest platform face in
+// its path. Only platforms it already overlaps on x can be hit, using the same strict
+// test as check_overlap so that grazing a corner behaves exactly like the discrete step.
+// The distance is the discrete step's own v * dt, so when nothing is in the way both
+// modes move the body to the same bits; the sweep only adds the stop at the first face.
+void PhysicsWorld::sweep_y(int body, Scalar delta_time)
+{
+    Scalar distance = m_velocity_y[body] * delta_time,
+           start    = m_position_y[body],
+           limit    = start + distance;
+    if (distance == 0.0f) return;
+
+    AABB swept = get_bounds(body);
+    if (distance < 0.0f) swept.min_y += to_float(distance);
+    else swept.max_y += to_float(distance);
+
+    thread_local std::vector<int> candidates;
+    gather_static(body, swept, candidates);
+
+    bool hit = false;
+    for (int index : candidates)
+    {
+        int other = m_static_bodies[index];
+        if (!collides_with(body, other) || !has_flag(other, BODY_ACTIVE)) continue;
+        if (!(fabs(m_position_x[body] - m_position_x[other]) - (m_half_width[body] + m_half_width[other]) < 0.0f)) continue;
+
+        if (distance < 0.0f)
+        {
+            Scalar top = m_position_y[other] + m_half_height[other];
+            if (start - m_half_height[body] < top - SWEEP_TOLERANCE) continue;
+
+            Scalar contact = flush_position(m_position_y[other], m_half_height[body] + m_half_height[other], 1.0f);
+            if (contact >= limit) { limit = contact; hit = true; }
+        } else
+        {
+            Scalar bottom = m_position_y[other] - m_half_height[other];
+            if (start + m_half_height[body] > bottom + SWEEP_TOLERANCE) continue;
+
+            Scalar contact = flush_position(m_position_y[other], m_half_height[body] + m_half_height[other], -1.0f);
+            if (contact <= limit) { limit = contact; hit = true; }
+        }
+    }
+
+    m_position_y[body] = limit;
+    if (hit)
+    {
+        m_contacts[body] |= distance < 0.0f ? CONTACT_BOTTOM : CONTACT_TOP;
+        m_velocity_y[body] = 0;
+    }
+}
+
+void PhysicsWorld::sweep_x(int body, Scalar delta_time)
+{
+    Scalar distance = m_velocity_x[body] * delta_time,
+           start    = m_position_x[body],
+           limit    = start + distance;
+    if (distance == 0.0f) return;
+
+    AABB swept = get_bounds(body);
+    if (distance < 0.0f) swept.min_x += to_float(distance);
+    else swept.max_x += to_float(distance);
+
+    thread_local std::vector<int> candidates;
+    gather_static(body, swept, candidates);
+
+    bool hit = false;
+    for (int index : candidates)
+    {
+        int other = m_static_bodies[index];
+        if (!collides_with(body, other) || !has_flag(other, BODY_ACTIVE)) continue;
+        if (!(fabs(m_position_y[body] - m_position_y[other]) - (m_half_height[body] + m_half_height[other]) < 0.0f)) continue;
+
+        if (distance < 0.0f)
+        {
+            Scalar right = m_position_x[other] + m_half_width[other];
+            if (start - m_half_width[body] < right - SWEEP_TOLERANCE) continue;
+
+            Scalar contact = flush_position(m_position_x[other], m_half_width[body] + m_half_width[other], 1.0f);
+            if (contact >= limit) { limit = contact; hit = true; }
+        } else
+        {
+            Scalar left = m_position_x[other] - m_half_width[other];
+            if (start + m_half_width[body] > left + SWEEP_TOLERANCE) continue;
+
+            Scalar contact = flush_position(m_position_x[other], m_half_width[body] + m_half_width[other], -1.0f);
+            if (contact <= limit) { limit = contact; hit = true; }
+        }
+    }
+
+    m_position_x[body] = limit;
+    if (hit)
+    {
+        m_contacts[body] |= distance < 0.0f ? CONTACT_LEFT : CONTACT_RIGHT;
+        m_velocity_x[body] = 0;
+    }
+}
+
+void PhysicsWorld::query_static(int body, int after_index, std::vector<int> &candidates)
+{
+    cached_static(body, get_bounds(body), candidates);
+
+    // Everything up to after_index has already been resolved by the caller
+    candidates.erase(candidates.begin(),
+                     std::upper_bound(candidates.begin(), candidates.end(), after_index));
+}
+
+// The overlap mask is only valid for the position it was computed at, so after a
+// pushout it is recomputed for the static bodies that have not been visited yet.
+void PhysicsWorld::scan_static_y(int body)
+{
+#ifdef PHYSICS_FIXED_POINT
+    // The overlap kernel works in floats. Walking the bodies in order and carrying on
+    // after a pushout visits them in the same order as the recomputed masks below.
+    for (int index = 0; index < (int) m_static_bodies.size(); index++)
+    {
+        int other = m_static_bodies[index];
+        if (collides_with(body, other)) resolve_pair_y(body, other);
+    }
+#else
+    thread_local std::vector<uint32_t> mask;
+
+    int first = 0, count = (int) m_static_bodies.size();
+    while (first < count)
+    {
+        BoxArrays boxes = { m_static_x.data() + first, m_static_y.data() + first,
+                            m_static_half_width.data() + first, m_static_half_height.data() + first };
+        mask.resize(get_overlap_mask_words(count - first));
+        overlap_mask(m_position_x[body], m_position_y[body], m_half_width[body], m_half_height[body],
+                     boxes, count - first, mask.data());
+
+        int next = count;
+        for (int word = 0; word < (int) mask.size() && next == count; word++)
+        {
+            for (uint32_t bits = mask[word]; bits != 0; bits &= bits - 1)
+            {
+                int index = first + word * 32 + __builtin_ctz(bits), other = m_static_bodies[index];
+                if (collides_with(body, other) && resolve_pair_y(body, other))
+                {
+                    next = index + 1;
+                    break;
+                }
+            }
+        }
+        first = next;
+    }
+#endif
+}
+
+void PhysicsWorld::scan_static_x(int body)
+{
+#ifdef PHYSICS_FIXED_POINT
+    // The overlap kernel works in floats. Walking the bodies in order and carrying on
+    // after a pushout visits them in the same order as the recomputed masks below.
+    for (int index = 0; index < (int) m_static_bodies.size(); index++)
+    {
+        int other = m_static_bodies[index];
+        if (collides_with(body, other)) resolve_pair_x(body, other);
+    }
+#else
+    thread_local std::vector<uint32_t> mask;
+
+    int first = 0, count = (int) m_static_bodies.size();
+    while (first < count)
+    {
+        BoxArrays boxes = { m_static_x.data() + first, m_static_y.data() + first,
+                            m_static_half_width.data() + first, m_static_half_height.data() + first };
+        mask.resize(get_overlap_mask_words(count - first));
+        overlap_mask(m_position_x[body], m_position_y[body], m_half_width[body], m_half_height[body],
+                     boxes, count - first, mask.data());
+
+        int next = count;
+        for (int word = 0; word < (int) mask.size() && next == count; word++)
+        {
+            for (uint32_t bits = mask[word]; bits != 0; bits &= bits - 1)
+            {
+                int index = first + word * 32 + __builtin_ctz(bits), other = m_static_bodies[index];
+                if (collides_with(body, other) && resolve_pair_x(body, other))
+                {
+                    next = index + 1;
+                    break;
+                }
+            }
+        }
+        first = next;
+    }
+#endif
+}
+
+bool const PhysicsWorld::resolve_pair_y(int body, int other)
+{
+    if (!has_flag(other, BODY_ACTIVE) || !check_overlap(body, other)) return false;
+
+    Scalar y_distance = fabs(m_position_y[body] - m_position_y[other]);
+    Scalar y_overlap  = fabs(y_distance - m_half_height[body] - m_half_height[other]);
+    if (m_velocity_y[body] > 0)
+    {
+        m_position_y[body] -= y_overlap;
+        m_velocity_y[body]  = 0;
+        m_contacts[body]   |= CONTACT_TOP;
+    } else if (m_velocity_y[body] < 0)
+    {
+        m_position_y[body] += y_overlap;
+        m_velocity_y[body]  = 0;
+        m_contacts[body]   |= CONTACT_BOTTOM;
+    } else
+    {
+        return false;
+    }
+
+    if (has_flag(other, BODY_HOSTILE)) m_contacts[body] |= CONTACT_HOSTILE;
+    return true;
+}
+
+bool const PhysicsWorld::resolve_pair_x(int body, int other)
+{
+    if (!has_flag(other, BODY_ACTIVE) || !check_overlap(body, other)) return false;
+
+    Scalar x_distance = fabs(m_position_x[body] - m_position_x[other]);
+    Scalar x_overlap  = fabs(x_distance - m_half_width[body] - m_half_width[other]);
+    if (m_velocity_x[body] > 0)
+    {
+        m_position_x[body] -= x_overlap;
+        m_velocity_x[body]  = 0;
+        m_contacts[body]   |= CONTACT_RIGHT;
+    } else if (m_velocity_x[body] < 0)
+    {
+        m_position_x[body] += x_overlap;
+        m_velocity_x[body]  = 0;
+        m_contacts[body]   |= CONTACT_LEFT;
+    } else
+    {
+        return false;
+    }
+
+    if (has_flag(other, BODY_HOSTILE)) m_contacts[body] |= CONTACT_HOSTILE;
+    return true;
+}
+
+void PhysicsWorld::resolve_y(int body)
+{
+    // The layer masks drop whole halves of the collider set before any narrowphase:
+    // static geometry in broadphase order first, then the other dynamic bodies
+    if ((m_masks[body] & m_static_layers) != 0 && m_broadphase == nullptr)
+    {
+        scan_static_y(body);
+    } else if ((m_masks[body] & m_static_layers) != 0)
+    {
+        // Same pushout order as a linear scan: candidates come back sorted, and a
+        // pushout moves the body, so the rest are re-queried from the new position.
+        thread_local std::vector<int> candidates;
+        query_static(body, -1, candidates);
+
+        for (int k = 0; k < (int) candidates.size(); k++)
+        {
+            int index = candidates[k], other = m_static_bodies[index];
+            if (collides_with(body, other) && resolve_pair_y(body, other))
+            {
+                query_static(body, index, candidates);
+                k = -1;
+            }
+        }
+    }
+
+    if ((m_masks[body] & m_dynamic_layers) == 0) return;
+
+    for (int other : m_dynamic_bodies)
+        if (other != body && collides_with(body, other) && resolve_pair_y(body, other)) wake_body(other);
+}
+
+void PhysicsWorld::resolve_x(int body)
+{
+    if ((m_masks[body] & m_static_layers) != 0 && m_broadphase == nullptr)
+    {
+        scan_static_x(body);
+    } else if ((m_masks[body] & m_static_layers) != 0)
+    {
+        thread_local std::vector<int> candidates;
+        query_static(body, -1, candidates);
+
+        for (int k = 0; k < (int) candidates.size(); k++)
+        {
+            int index = candidates[k], other = m_static_bodies[index];
+            if (collides_with(body, other) && resolve_pair_x(body, other))
+            {
+                query_static(body, index, candidates);
+                k = -1;
+            }
+        }
+    }
+
+    if ((m_masks[body] & m_dynamic_layers) == 0) return;
+
+    for (int other : m_dynamic_bodies)
+        if (other != body && collides_with(body, other) && resolve_pair_x(body, other)) wake_body(other);
+}
+
+// ————— PHYSICS BODY ————— //
+PhysicsBody::PhysicsBody() : m_world(PhysicsWorld::get_current())
+{
+    assert(m_world != nullptr && "make a PhysicsWorld current before creating entities");
+    m_index = m_world->create_body();
+}
+
+PhysicsBody::PhysicsBody(const PhysicsBody &other) : m_world(other.m_world)
+{
+    m_index = m_world->create_body();
+    m_world->copy_body(m_index, other.m_index);
+}
+
+PhysicsBody& PhysicsBody::operator=(const PhysicsBody &other)
+{
+    assert(m_world == other.m_world);
+    m_world->copy_body(m_index, other.m_index);
+    return *this;
+}
+
+PhysicsBody::~PhysicsBody()
+{
+    m_world->destroy_body(m_index);
+}
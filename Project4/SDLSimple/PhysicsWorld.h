@@ -0,0 +1,228 @@
+#ifndef PHYSICS_WORLD_H
+#define PHYSICS_WORLD_H
+
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "OverlapKernel.h"
+#include "Broadphase.h"
+#include "StaticBVH.h"
+#include "Fixed.h"
+
+// Define PHYSICS_FIXED_POINT (add it to the target's preprocessor macros) to run the
+// movement, gravity and pushout math in Q16.16 fixed point. The same input stream then
+// gives bit-identical trajectories on every machine and compiler, for lockstep
+// verification and replays. Floats are still used at the interface and for broadphase
+// bounds, which only ever widen a query.
+#ifdef PHYSICS_FIXED_POINT
+typedef Fixed Scalar;
+#else
+typedef float Scalar;
+#endif
+
+/**
+ * Owns the simulated state of every body in structure-of-arrays form, so that a
+ * step only walks the handful of float arrays it actually needs. Entities refer
+ * to their body by index through a PhysicsBody.
+ */
+class PhysicsWorld
+{
+public:
+    enum BodyFlag : uint8_t
+    {
+        BODY_ACTIVE   = 1 << 0,
+        BODY_DYNAMIC  = 1 << 1, // integrated and resolved every step; otherwise static geometry
+        BODY_HOSTILE  = 1 << 2, // touching it raises CONTACT_HOSTILE
+        BODY_SLEEPING = 1 << 3  // at rest; skipped by step until something wakes it
+    };
+
+    enum ContactFlag : uint8_t
+    {
+        CONTACT_TOP     = 1 << 0,
+        CONTACT_BOTTOM  = 1 << 1,
+        CONTACT_LEFT    = 1 << 2,
+        CONTACT_RIGHT   = 1 << 3,
+        CONTACT_HOSTILE = 1 << 4
+    };
+
+private:
+    // ————— BODIES ————— //
+    std::vector<Scalar> m_position_x, m_position_y,
+                        m_velocity_x, m_velocity_y,
+                        m_acceleration_x, m_acceleration_y,
+                        m_half_width, m_half_height;
+    std::vector<uint8_t> m_flags;
+    std::vector<uint8_t> m_layers, m_masks; // a body is pushed out of another when its mask has the other's layer
+    std::vector<uint8_t> m_contacts;
+    std::vector<uint8_t> m_rest_steps; // consecutive steps ended with zero velocity
+
+    std::vector<int> m_free_bodies;
+    std::vector<int> m_dynamic_bodies; // in creation order, which is also resolution order
+    std::vector<int> m_awake_bodies;   // the active, non-sleeping part of m_dynamic_bodies for this step
+
+    // ————— SLEEPING ————— //
+    bool m_sleeping = true;
+    uint8_t m_static_layers  = 0, // every layer present among static and dynamic bodies, so
+            m_dynamic_layers = 0; // a mask with none of them skips that half of resolution
+    int  m_awake_count    = 0,
+         m_sleeping_count = 0;
+
+    // ————— STATIC GEOMETRY ————— //
+    std::vector<int>  m_static_bodies;  // broadphase index -> body
+    std::vector<float> m_static_x, m_static_y,
+                       m_static_half_width, m_static_half_height; // packed for the overlap kernel
+    StaticBVH         m_static_bvh;
+    const Broadphase* m_broadphase = nullptr;
+
+    bool m_continuous = false;
+
+    // ————— CONTACT CACHE ————— //
+    // Each body keeps the static bodies found around it by its last broadphase query,
+    // padded by a margin. While the body stays inside that region the list still holds
+    // everything it can touch, so the broadphase is skipped.
+    bool m_contact_caching = true;
+    std::vector<AABB>             m_cache_regions;
+    std::vector<std::vector<int>> m_cached_statics;
+    uint64_t m_cache_hits   = 0,
+             m_cache_misses = 0;
+
+    static PhysicsWorld* s_current;
+
+    void resolve_y(int body);
+    void resolve_x(int body);
+    bool const resolve_pair_y(int body, int other);
+    bool const resolve_pair_x(int body, int other);
+    void query_static(int body, int after_index, std::vector<int> &candidates);
+    void scan_static_y(int body);
+    void scan_static_x(int body);
+    void gather_static(int body, const AABB &bounds, std::vector<int> &out);
+    void cached_static(int body, const AABB &bounds, std::vector<int> &out);
+    void invalidate_contact_caches();
+    void move_y(int body, Scalar delta_time);
+    void move_x(int body, Scalar delta_time);
+    void sweep_y(int body, Scalar delta_time);
+    void sweep_x(int body, Scalar delta_time);
+    void update_rest(int body);
+
+    template <typename T>
+    void wake_if_changed(int body, const T &current, const T &value) { if (current != value) wake_body(body); }
+
+public:
+    // ————— METHODS ————— //
+    ~PhysicsWorld();
+
+    int  create_body();
+    void destroy_body(int body);
+    void copy_body(int destination, int source);
+
+    // Collects every static body on a layer and builds the BVH over them. Call again
+    // whenever static geometry is added, moved or removed.
+    void build_static_broadphase();
+    void step(float delta_time);
+
+    bool const check_overlap(int body, int other) const;
+    bool const collides_with(int body, int other) const { return (m_masks[body] & m_layers[other]) != 0; }
+
+    // Sleeping bodies keep their place and contacts but are not integrated or resolved.
+    // Setting a body's position, velocity or acceleration to something new wakes it, as
+    // does another body colliding with it.
+    void wake_body(int body) { m_rest_steps[body] = 0; m_flags[body] &= ~BODY_SLEEPING; }
+    void wake_near(glm::vec2 position, float radius);
+    void wake_all();
+
+    // Entities constructed from now on get their bodies from this world
+    void make_current() { s_current = this; }
+    static PhysicsWorld* get_current() { return s_current; }
+
+    // ————— GETTERS ————— //
+    glm::vec2 const get_position(int body)     const { return glm::vec2(to_float(m_position_x[body]), to_float(m_position_y[body])); }
+    glm::vec2 const get_velocity(int body)     const { return glm::vec2(to_float(m_velocity_x[body]), to_float(m_velocity_y[body])); }
+    glm::vec2 const get_acceleration(int body) const { return glm::vec2(to_float(m_acceleration_x[body]), to_float(m_acceleration_y[body])); }
+    float     const get_half_width(int body)   const { return to_float(m_half_width[body]);  }
+    float     const get_half_height(int body)  const { return to_float(m_half_height[body]); }
+    AABB      const get_bounds(int body)       const
+    {
+        return { to_float(m_position_x[body] - m_half_width[body]), to_float(m_position_y[body] - m_half_height[body]),
+                 to_float(m_position_x[body] + m_half_width[body]), to_float(m_position_y[body] + m_half_height[body]) };
+    }
+
+    // The raw positions, for checking that two runs match bit for bit
+    Scalar    const get_exact_x(int body)      const { return m_position_x[body]; }
+    Scalar    const get_exact_y(int body)      const { return m_position_y[body]; }
+
+    uint8_t   const get_layer(int body)        const { return m_layers[body]; }
+    uint8_t   const get_mask(int body)         const { return m_masks[body];  }
+
+    bool const has_flag(int body, BodyFlag flag)       const { return (m_flags[body] & flag) != 0;    }
+    bool const has_contact(int body, ContactFlag flag) const { return (m_contacts[body] & flag) != 0; }
+
+    int  const get_body_count()    const { return (int) m_flags.size();          }
+    int  const get_dynamic_count() const { return (int) m_dynamic_bodies.size(); }
+    int  const get_static_count()  const { return (int) m_static_bodies.size();  }
+    int  const get_awake_count()    const { return m_awake_count;    } // as of the last step
+    int  const get_sleeping_count() const { return m_sleeping_count; }
+    void get_static_bounds(std::vector<AABB> &out) const;
+
+    // ————— SETTERS ————— //
+    void const set_position(int body, glm::vec2 position)         { wake_if_changed(body, get_position(body), position); m_position_x[body] = position.x; m_position_y[body] = position.y; }
+    void const set_position_y(int body, float y)                  { wake_if_changed(body, m_position_y[body], Scalar(y)); m_position_y[body] = y; }
+    void const set_velocity(int body, glm::vec2 velocity)         { wake_if_changed(body, get_velocity(body), velocity); m_velocity_x[body] = velocity.x; m_velocity_y[body] = velocity.y; }
+    void const set_velocity_x(int body, float x)                  { wake_if_changed(body, m_velocity_x[body], Scalar(x)); m_velocity_x[body] = x; }
+    void const set_velocity_y(int body, float y)                  { wake_if_changed(body, m_velocity_y[body], Scalar(y)); m_velocity_y[body] = y; }
+    void const set_acceleration(int body, glm::vec2 acceleration) { wake_if_changed(body, get_acceleration(body), acceleration); m_acceleration_x[body] = acceleration.x; m_acceleration_y[body] = acceleration.y; }
+    void const set_half_width(int body, float half_width)         { m_half_width[body]  = half_width;  }
+    void const set_half_height(int body, float half_height)       { m_half_height[body] = half_height; }
+    void set_flag(int body, BodyFlag flag, bool value);
+
+    // Layers and masks are bitfields whose meaning is up to the game. Changing a static
+    // body's layer takes effect at the next build_static_broadphase.
+    void const set_layer(int body, uint8_t layer) { m_layers[body] = layer; }
+    void const set_mask(int body, uint8_t mask)   { wake_if_changed(body, m_masks[body], mask); m_masks[body] = mask; }
+
+    // Swaps the BVH for another broadphase over the same static bodies, indexed as in
+    // get_static_bounds. nullptr scans every static body with the SIMD overlap kernel.
+    void const set_broadphase(const Broadphase *broadphase) { m_broadphase = broadphase; invalidate_contact_caches(); }
+
+    // Continuous mode moves dynamic bodies by sweeping them against static geometry and
+    // stopping at the first time of impact, so that large steps cannot tunnel through
+    // thin platforms. Off by default; discrete pushout is still applied afterwards.
+    void const set_continuous(bool continuous) { m_continuous = continuous; }
+    bool const get_continuous() const { return m_continuous; }
+
+    // Only used with a broadphase. Off queries it for every static lookup.
+    void const set_contact_caching(bool caching) { m_contact_caching = caching; invalidate_contact_caches(); }
+    bool const get_contact_caching() const { return m_contact_caching; }
+
+    // Static lookups answered from the contact cache and from the broadphase
+    uint64_t const get_cache_hits()   const { return m_cache_hits;   }
+    uint64_t const get_cache_misses() const { return m_cache_misses; }
+    void reset_cache_counters() { m_cache_hits = m_cache_misses = 0; }
+
+    // Off keeps every dynamic body awake, as before sleeping existed
+    void const set_sleeping(bool sleeping) { m_sleeping = sleeping; if (!sleeping) wake_all(); }
+    bool const get_sleeping() const { return m_sleeping; }
+
+    StaticBVH* get_static_bvh() { return &m_static_bvh; }
+};
+
+/**
+ * An Entity's handle to its body. Copying an entity copies the body's state into
+ * a body of its own, and destroying the entity frees the body for reuse.
+ */
+class PhysicsBody
+{
+private:
+    PhysicsWorld* m_world;
+    int           m_index;
+
+public:
+    PhysicsBody();
+    PhysicsBody(const PhysicsBody &other);
+    PhysicsBody& operator=(const PhysicsBody &other);
+    ~PhysicsBody();
+
+    PhysicsWorld* const get_world() const { return m_world; }
+    int           const get_index() const { return m_index; }
+};
+
+#endif // PHYSICS_WORLD_H
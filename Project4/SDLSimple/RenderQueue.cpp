@@ -0,0 +1,179 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <cmath>
+#include <cstring>
+#include "RenderQueue.h"
+
+// Enough for the level as it stands without growing mid-frame
+constexpr int INITIAL_COMMAND_CAPACITY = 256;
+
+constexpr int RADIX_BITS    = 8,
+              RADIX_BUCKETS = 1 << RADIX_BITS,
+              RADIX_PASSES  = 64 / RADIX_BITS;
+
+RenderQueue::RenderQueue() : m_view({ -INFINITY, -INFINITY, INFINITY, INFINITY })
+{
+    m_commands.reserve(INITIAL_COMMAND_CAPACITY);
+    m_order.reserve(INITIAL_COMMAND_CAPACITY);
+    m_scratch.reserve(INITIAL_COMMAND_CAPACITY);
+}
+
+uint64_t RenderQueue::make_key(uint8_t layer, uint8_t shader, GLuint texture_id, float depth)
+{
+    // Flipping the sign bit of positive floats, and every bit of negative ones, makes
+    // their bits sort as unsigned integers in the same order as the values
+    uint32_t depth_bits;
+    memcpy(&depth_bits, &depth, sizeof(depth_bits));
+    depth_bits = (depth_bits & 0x80000000u) ? ~depth_bits : depth_bits | 0x80000000u;
+
+    // Texture names are small integers handed out in order, so the low 16 bits tell
+    // them apart; two that did collide would only cost an extra draw
+    return ((uint64_t) layer << 56) | ((uint64_t) shader << 48) | ((uint64_t) (texture_id & 0xFFFF) << 32) |
+           depth_bits;
+}
+
+void RenderQueue::push(uint8_t layer, uint8_t shader, float depth, const RenderCommand &command)
+{
+    m_order.push_back({ make_key(layer, shader, command.texture_id, depth), (int) m_commands.size() });
+    m_commands.push_back(command);
+    m_is_sorted = false;
+}
+
+void RenderQueue::submit_sprite(uint8_t layer, GLuint texture_id, const Transform2D &transform, glm::vec2 uv_offset,
+                                glm::vec2 uv_size, float depth)
+{
+    if (m_has_view && !SpriteBatch::get_quad_bounds(transform).overlaps(m_view))
+    {
+        m_culled_count++;
+        return;
+    }
+
+    RenderCommand command = {};
+    command.type       = RENDER_SPRITE;
+    command.texture_id = texture_id;
+    command.transform  = transform;
+    command.uv_offset  = uv_offset;
+    command.uv_size    = uv_size;
+    push(layer, SHADER_SPRITE, depth, command);
+}
+
+void RenderQueue::submit_mesh(uint8_t layer, GLuint texture_id, const std::vector<float> &mesh, glm::vec3 offset,
+                              float depth)
+{
+    RenderCommand command = {};
+    command.type       = RENDER_MESH;
+    command.texture_id = texture_id;
+    command.mesh       = &mesh;
+    command.offset     = offset;
+    push(layer, SHADER_SPRITE, depth, command);
+}
+
+void RenderQueue::submit_static_mesh(uint8_t layer, StaticMesh *static_mesh, float depth)
+{
+    RenderCommand command = {};
+    command.type        = RENDER_STATIC_MESH;
+    command.static_mesh = static_mesh;
+    push(layer, SHADER_SPRITE, depth, command);
+}
+
+void RenderQueue::submit_instances(uint8_t layer, SpriteInstances *instances, float depth)
+{
+    RenderCommand command = {};
+    command.type      = RENDER_INSTANCES;
+    command.instances = instances;
+    push(layer, SHADER_INSTANCED, depth, command);
+}
+
+void RenderQueue::sort()
+{
+    if (m_is_sorted) return;
+    m_is_sorted = true;
+
+    int count = (int) m_order.size();
+    if (count < 2) return;
+
+    // Which bits differ anywhere; passes over a byte no key varies in are skipped
+    uint64_t first_key = m_order[0].key, varying_bits = 0;
+    for (const SortEntry &entry : m_order) varying_bits |= entry.key ^ first_key;
+
+    m_scratch.resize(count);
+    for (int pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        int shift = pass * RADIX_BITS;
+        if (((varying_bits >> shift) & (RADIX_BUCKETS - 1)) == 0) continue;
+
+        int offsets[RADIX_BUCKETS] = { 0 };
+        for (const SortEntry &entry : m_order) offsets[(entry.key >> shift) & (RADIX_BUCKETS - 1)]++;
+
+        int total = 0;
+        for (int &offset : offsets)
+        {
+            int bucket_count = offset;
+            offset = total;
+            total += bucket_count;
+        }
+
+        for (const SortEntry &entry : m_order) m_scratch[offsets[(entry.key >> shift) & (RADIX_BUCKETS - 1)]++] = entry;
+        m_order.swap(m_scratch);
+    }
+}
+
+void RenderQueue::execute(SpriteBatch *batch, GpuProfiler *profiler)
+{
+    sort();
+
+    int layer = -1;
+    batch->begin();
+    for (const SortEntry &entry : m_order)
+    {
+        // The batch is flushed at every layer, so each pass only times its own draws
+        if (profiler != NULL && (int) (entry.key >> 56) != layer)
+        {
+            batch->end();
+            layer = (int) (entry.key >> 56);
+            profiler->begin_pass(layer);
+            batch->begin();
+        }
+
+        const RenderCommand &command = m_commands[entry.command];
+        switch (command.type)
+        {
+            case RENDER_SPRITE:
+                batch->draw(command.texture_id, command.transform, command.uv_offset, command.uv_size);
+                break;
+
+            case RENDER_MESH:
+                batch->draw_mesh(command.texture_id, *command.mesh, command.offset);
+                break;
+
+            // These draw from buffers of their own, so what the batch holds goes first
+            case RENDER_STATIC_MESH:
+                batch->end();
+                command.static_mesh->render(m_view);
+                batch->begin();
+                break;
+
+            case RENDER_INSTANCES:
+                batch->end();
+                command.instances->render(m_view);
+                batch->begin();
+                break;
+        }
+    }
+    batch->end();
+    if (profiler != NULL) profiler->end_pass();
+
+    clear();
+}
+
+void RenderQueue::clear()
+{
+    m_commands.clear();
+    m_order.clear();
+    m_is_sorted = false;
+}
@@ -0,0 +1,108 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+#include "SpriteBatch.h"
+#include "SpriteInstances.h"
+#include "StaticMesh.h"
+#include "GpuProfiler.h"
+
+enum RenderCommandType { RENDER_SPRITE, RENDER_MESH, RENDER_STATIC_MESH, RENDER_INSTANCES };
+
+struct RenderCommand
+{
+    RenderCommandType type;
+    GLuint            texture_id;
+
+    // RENDER_SPRITE
+    Transform2D transform;
+    glm::vec2 uv_offset, uv_size;
+
+    // RENDER_MESH: vertices in SpriteBatch's layout, drawn moved by offset
+    const std::vector<float>* mesh;
+    glm::vec3                 offset;
+
+    // RENDER_STATIC_MESH and RENDER_INSTANCES
+    StaticMesh*      static_mesh;
+    SpriteInstances* instances;
+};
+
+/**
+ * Collects a frame's draws as commands with 64-bit sort keys, sorts them, and
+ * replays them through a SpriteBatch. From the top bit down a key holds:
+ *
+ *     layer (8) | shader (8) | texture (16) | depth (32)
+ *
+ * Layers are drawn in order, so they carry the z-layering. Inside a layer,
+ * commands are grouped by shader and texture to save state changes, then drawn
+ * in increasing depth, with ties kept in submission order. Sprites in one layer
+ * that overlap must therefore share a texture, or be given layers of their own.
+ *
+ * Once a view is set, sprites that fall outside it are dropped as they are
+ * submitted, and static meshes and instances draw only what it overlaps.
+ */
+class RenderQueue
+{
+private:
+    struct SortEntry
+    {
+        uint64_t key;
+        int      command;
+    };
+
+    std::vector<RenderCommand> m_commands;
+    std::vector<SortEntry>     m_order, m_scratch;
+    bool                       m_is_sorted = false;
+
+    AABB m_view;
+    bool m_has_view = false;
+
+    // ————— STATISTICS ————— //
+    int m_culled_count = 0;
+
+    void push(uint8_t layer, uint8_t shader, float depth, const RenderCommand &command);
+
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr uint8_t SHADER_SPRITE    = 0,
+                             SHADER_INSTANCED = 1;
+
+    // ————— METHODS ————— //
+    RenderQueue();
+
+    static uint64_t make_key(uint8_t layer, uint8_t shader, GLuint texture_id, float depth);
+
+    void submit_sprite(uint8_t layer, GLuint texture_id, const Transform2D &transform, glm::vec2 uv_offset = glm::vec2(0.0f),
+                       glm::vec2 uv_size = glm::vec2(1.0f), float depth = 0.0f);
+    void submit_mesh(uint8_t layer, GLuint texture_id, const std::vector<float> &mesh, glm::vec3 offset,
+                     float depth = 0.0f);
+    void submit_static_mesh(uint8_t layer, StaticMesh *static_mesh, float depth = 0.0f);
+    void submit_instances(uint8_t layer, SpriteInstances *instances, float depth = 0.0f);
+
+    // Radix sorts the keys, eight bits a pass, skipping bytes every key shares.
+    // LSD radix sort is stable, which is what keeps ties in submission order.
+    void sort();
+
+    // Sorts if needed, draws everything, and empties the queue for the next frame.
+    // Given a profiler, each layer is timed as a pass numbered by the layer.
+    void execute(SpriteBatch *batch, GpuProfiler *profiler = NULL);
+    void clear();
+
+    void reset_counters() { m_culled_count = 0; }
+
+    // ————— GETTERS ————— //
+    int const get_command_count() const { return (int) m_commands.size(); }
+    int const get_culled_count()  const { return m_culled_count; }
+
+    // The i-th command in sorted order; only valid after sort()
+    const RenderCommand &get_sorted_command(int i) const { return m_commands[m_order[i].command]; }
+    uint64_t const get_sorted_key(int i) const { return m_order[i].key; }
+
+    // ————— SETTERS ————— //
+    // The world-space rectangle on screen; until one is set nothing is culled
+    void const set_view(const AABB &new_view) { m_view = new_view; m_has_view = true; }
+};
+
+#endif // RENDER_QUEUE_H
@@ -2,6 +2,10 @@
 
 #include "ShaderProgram.h"
 
+GLuint ShaderProgram::s_bound_program = 0;
+int    ShaderProgram::s_calls_issued  = 0,
+       ShaderProgram::s_calls_skipped = 0;
+
 void ShaderProgram::load(const char *vertex_shader_file, const char *fragment_shader_file) {
     
     // create the vertex shader
@@ -88,26 +92,64 @@ GLuint ShaderProgram::load_shader_from_string(const std::string &shaderContents,
     return shaderID;
 }
 
-void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
+void ShaderProgram::use()
 {
+    if (s_bound_program == m_program_id)
+    {
+        s_calls_skipped++;
+        return;
+    }
+
     glUseProgram(m_program_id);
+    s_bound_program = m_program_id;
+    s_calls_issued++;
+}
+
+bool const ShaderProgram::should_upload(GLint location, bool &has_value, bool same_value)
+{
+    // A uniform the shader does not have, or one already holding this value, needs
+    // no call at all
+    if (location == -1 || (has_value && same_value))
+    {
+        s_calls_skipped++;
+        return false;
+    }
+
+    has_value = true;
+    use();
+    s_calls_issued++;
+    return true;
+}
+
+void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
+{
+    glm::vec4 colour = glm::vec4(red, green, blue, alpha);
+    if (!should_upload(m_colour_uniform, m_has_colour, colour == m_colour)) return;
+
+    m_colour = colour;
     glUniform4f(m_colour_uniform, red, green, blue, alpha);
 }
 
 void ShaderProgram::set_view_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
+    if (!should_upload(m_view_matrix_uniform, m_has_view_matrix, matrix == m_view_matrix)) return;
+
+    m_view_matrix = matrix;
     glUniformMatrix4fv(m_view_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
 }
 
 void ShaderProgram::set_model_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
+    if (!should_upload(m_model_matrix_uniform, m_has_model_matrix, matrix == m_model_matrix)) return;
+
+    m_model_matrix = matrix;
     glUniformMatrix4fv(m_model_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
 }
 
 void ShaderProgram::set_projection_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
+    if (!should_upload(m_projection_matrix_uniform, m_has_projection_matrix, matrix == m_projection_matrix)) return;
+
+    m_projection_matrix = matrix;
     glUniformMatrix4fv(m_projection_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
 }
@@ -10,6 +10,7 @@
 #include <fstream>
 #include <sstream>
 #include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
 
 class ShaderProgram
 {
@@ -21,16 +22,28 @@ private:
 
     GLuint m_program_id;
 
-    GLuint m_projection_matrix_uniform;
-    GLuint m_model_matrix_uniform;
-    GLuint m_view_matrix_uniform;
-    GLuint m_colour_uniform;
+    GLint m_projection_matrix_uniform;
+    GLint m_model_matrix_uniform;
+    GLint m_view_matrix_uniform;
+    GLint m_colour_uniform;
 
     GLuint m_position_attribute;
     GLuint m_tex_coord_attribute;
 
     GLuint m_vertex_shader;
     GLuint m_fragment_shader;
+
+    // The last values uploaded, so that setting the same value again costs no GL call
+    glm::mat4 m_model_matrix, m_view_matrix, m_projection_matrix;
+    glm::vec4 m_colour;
+    bool m_has_model_matrix = false, m_has_view_matrix = false,
+         m_has_projection_matrix = false, m_has_colour = false;
+
+    // glUseProgram is context-wide, so the bound program is shared by every instance
+    static GLuint s_bound_program;
+    static int s_calls_issued, s_calls_skipped;
+
+    bool const should_upload(GLint location, bool &has_value, bool same_value);
     
 public:
 
@@ -40,6 +53,15 @@ public:
     void set_projection_matrix(const glm::mat4 &matrix);
     void set_view_matrix(const glm::mat4 &matrix);
     void set_colour(float red, float green, float blue, float alpha);
+
+    // Binds the program unless it is already bound. Use this rather than glUseProgram
+    // so the cached binding stays true.
+    void use();
+
+    // GL calls made and avoided by the caches, summed over every program
+    static int const get_calls_issued()  { return s_calls_issued;  }
+    static int const get_calls_skipped() { return s_calls_skipped; }
+    static void reset_counters() { s_calls_issued = 0; s_calls_skipped = 0; }
     
     GLuint const get_program_id()               const { return m_program_id;          };
     GLuint const get_position_attribute()       const { return m_position_attribute;  };
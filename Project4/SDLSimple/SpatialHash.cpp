@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <cmath>
+#include "SpatialHash.h"
+
+// Queries are padded by this fraction of a cell so that boxes whose edges land
+// exactly on a cell boundary are never missed because of rounding.
+constexpr float QUERY_PADDING = 1.0e-4f;
+
+SpatialHash::SpatialHash(float cell_size) : m_cell_size(cell_size) { }
+
+int const SpatialHash::cell_coordinate(float value) const
+{
+    return (int) std::floor(value / m_cell_size);
+}
+
+uint64_t const SpatialHash::cell_key(int cell_x, int cell_y) const
+{
+    return ((uint64_t) (uint32_t) cell_x << 32) | (uint64_t) (uint32_t) cell_y;
+}
+
+void SpatialHash::insert(int index, const AABB &bounds)
+{
+    int first_x = cell_coordinate(bounds.min_x), last_x = cell_coordinate(bounds.max_x);
+    int first_y = cell_coordinate(bounds.min_y), last_y = cell_coordinate(bounds.max_y);
+
+    for (int cell_x = first_x; cell_x <= last_x; cell_x++)
+        for (int cell_y = first_y; cell_y <= last_y; cell_y++)
+            m_cells[cell_key(cell_x, cell_y)].push_back(index);
+}
+
+void SpatialHash::query(const AABB &bounds, std::vector<int> &out) const
+{
+    out.clear();
+
+    float padding = m_cell_size * QUERY_PADDING;
+    int first_x = cell_coordinate(bounds.min_x - padding), last_x = cell_coordinate(bounds.max_x + padding);
+    int first_y = cell_coordinate(bounds.min_y - padding), last_y = cell_coordinate(bounds.max_y + padding);
+
+    for (int cell_x = first_x; cell_x <= last_x; cell_x++)
+    {
+        for (int cell_y = first_y; cell_y <= last_y; cell_y++)
+        {
+            auto cell = m_cells.find(cell_key(cell_x, cell_y));
+            if (cell != m_cells.end()) out.insert(out.end(), cell->second.begin(), cell->second.end());
+        }
+    }
+
+    // A box spanning several cells shows up once per cell
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
@@ -0,0 +1,40 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Broadphase.h"
+
+/**
+ * Uniform grid broadphase. Boxes are stored by index in every cell they touch,
+ * and queries return the indices of all boxes sharing a cell with the query box,
+ * sorted ascending so that callers can resolve them in the same order as a
+ * linear scan over the original array.
+ */
+class SpatialHash : public Broadphase
+{
+private:
+    float m_cell_size;
+    std::unordered_map<uint64_t, std::vector<int>> m_cells;
+
+    int const cell_coordinate(float value) const;
+    uint64_t const cell_key(int cell_x, int cell_y) const;
+
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr float DEFAULT_CELL_SIZE = 2.0f;
+
+    // ————— METHODS ————— //
+    SpatialHash(float cell_size = DEFAULT_CELL_SIZE);
+
+    void clear() { m_cells.clear(); }
+    void insert(int index, const AABB &bounds);
+    void query(const AABB &bounds, std::vector<int> &out) const override;
+
+    // ————— GETTERS ————— //
+    float const get_cell_size()  const { return m_cell_size;    }
+    int   const get_cell_count() const { return (int) m_cells.size(); }
+};
+
+#endif // SPATIAL_HASH_H
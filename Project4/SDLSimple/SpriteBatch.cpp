@@ -0,0 +1,151 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <algorithm>
+#include <cmath>
+#include "SpriteBatch.h"
+
+// Enough for every sprite in the level without growing the stream mid-frame
+constexpr int INITIAL_SPRITE_CAPACITY = 256;
+
+SpriteBatch::SpriteBatch(ShaderProgram* program) : m_program(program)
+{
+    m_vertices.reserve(INITIAL_SPRITE_CAPACITY * VERTICES_PER_SPRITE * FLOATS_PER_VERTEX);
+}
+
+void SpriteBatch::begin()
+{
+    m_vertices.clear();
+    m_runs.clear();
+
+    // Another program may have been bound since the last begin()
+    m_program->use();
+    m_program->set_model_matrix(glm::mat4(1.0f));
+
+    // Offsets into the stream are whole vertices, so the layout is set once here
+    // and every run picks its vertices with glDrawArrays' first argument
+    m_stream.bind();
+
+    set_vertex_layout(m_program);
+}
+
+void SpriteBatch::reset_counters()
+{
+    m_draw_calls   = 0;
+    m_sprite_count = 0;
+    m_stream.reset_counters();
+}
+
+void SpriteBatch::append_quad(std::vector<float> &vertices, const Transform2D &transform, glm::vec2 uv_offset,
+                              glm::vec2 uv_size)
+{
+    // The same corners and winding Entity::render has always drawn, with v running
+    // down the texture. z is kept because the projection clips it, which trims
+    // sprites that are rotated out of the screen plane.
+    glm::vec3 bottom_left  = transform.apply(glm::vec2(-0.5f, -0.5f)),
+              bottom_right = transform.apply(glm::vec2( 0.5f, -0.5f)),
+              top_right    = transform.apply(glm::vec2( 0.5f,  0.5f)),
+              top_left     = transform.apply(glm::vec2(-0.5f,  0.5f));
+
+    float u_left   = uv_offset.x,
+          u_right  = uv_offset.x + uv_size.x,
+          v_top    = uv_offset.y,
+          v_bottom = uv_offset.y + uv_size.y;
+
+    vertices.insert(vertices.end(), {
+        bottom_left.x,  bottom_left.y,  bottom_left.z,  u_left,  v_bottom,
+        bottom_right.x, bottom_right.y, bottom_right.z, u_right, v_bottom,
+        top_right.x,    top_right.y,    top_right.z,    u_right, v_top,
+        bottom_left.x,  bottom_left.y,  bottom_left.z,  u_left,  v_bottom,
+        top_right.x,    top_right.y,    top_right.z,    u_right, v_top,
+        top_left.x,     top_left.y,     top_left.z,     u_left,  v_top
+    });
+}
+
+AABB SpriteBatch::get_quad_bounds(const Transform2D &transform)
+{
+    AABB bounds = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+    for (float x : { -0.5f, 0.5f })
+    {
+        for (float y : { -0.5f, 0.5f })
+        {
+            glm::vec3 corner = transform.apply(glm::vec2(x, y));
+            bounds.min_x = std::min(bounds.min_x, corner.x);
+            bounds.min_y = std::min(bounds.min_y, corner.y);
+            bounds.max_x = std::max(bounds.max_x, corner.x);
+            bounds.max_y = std::max(bounds.max_y, corner.y);
+        }
+    }
+    return bounds;
+}
+
+void SpriteBatch::append_mesh(std::vector<float> &vertices, const std::vector<float> &mesh, glm::vec3 offset)
+{
+    for (size_t i = 0; i < mesh.size(); i += FLOATS_PER_VERTEX)
+    {
+        vertices.insert(vertices.end(), {
+            mesh[i] + offset.x, mesh[i + 1] + offset.y, mesh[i + 2] + offset.z, mesh[i + 3], mesh[i + 4]
+        });
+    }
+}
+
+void SpriteBatch::set_vertex_layout(ShaderProgram* program)
+{
+    glVertexAttribPointer(program->get_position_attribute(), 3, GL_FLOAT, false, VERTEX_SIZE, (const void*) 0);
+    glEnableVertexAttribArray(program->get_position_attribute());
+    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, VERTEX_SIZE,
+                          (const void*) (3 * sizeof(float)));
+    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
+}
+
+void SpriteBatch::draw(GLuint texture_id, const Transform2D &transform, glm::vec2 uv_offset, glm::vec2 uv_size)
+{
+    int first = (int) (m_vertices.size() / FLOATS_PER_VERTEX);
+    if (m_runs.empty() || m_runs.back().texture_id != texture_id) m_runs.push_back({ texture_id, first, 0 });
+    m_runs.back().count += VERTICES_PER_SPRITE;
+
+    append_quad(m_vertices, transform, uv_offset, uv_size);
+    m_sprite_count++;
+}
+
+void SpriteBatch::draw_mesh(GLuint texture_id, const std::vector<float> &mesh, glm::vec3 offset)
+{
+    if (mesh.empty()) return;
+
+    int first = (int) (m_vertices.size() / FLOATS_PER_VERTEX);
+    if (m_runs.empty() || m_runs.back().texture_id != texture_id) m_runs.push_back({ texture_id, first, 0 });
+    m_runs.back().count += (int) (mesh.size() / FLOATS_PER_VERTEX);
+
+    append_mesh(m_vertices, mesh, offset);
+    m_sprite_count += (int) (mesh.size() / (FLOATS_PER_VERTEX * VERTICES_PER_SPRITE));
+}
+
+void SpriteBatch::flush()
+{
+    if (m_vertices.empty()) return;
+
+    int base = m_stream.write(m_vertices.data(), (int) (m_vertices.size() * sizeof(float))) / VERTEX_SIZE;
+
+    for (const Run &run : m_runs)
+    {
+        glBindTexture(GL_TEXTURE_2D, run.texture_id);
+        glDrawArrays(GL_TRIANGLES, base + run.first, run.count);
+        m_draw_calls++;
+    }
+
+    m_vertices.clear();
+    m_runs.clear();
+}
+
+void SpriteBatch::end()
+{
+    flush();
+
+    glDisableVertexAttribArray(m_program->get_position_attribute());
+    glDisableVertexAttribArray(m_program->get_tex_coordinate_attribute());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
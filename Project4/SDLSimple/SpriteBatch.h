@@ -0,0 +1,84 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "Broadphase.h"
+#include "ShaderProgram.h"
+#include "Transform2D.h"
+#include "StreamBuffer.h"
+
+/**
+ * Gathers textured quads into one vertex stream and draws them together. Quads are
+ * transformed on the CPU, so the program's model matrix stays at identity. A new
+ * run starts whenever the texture changes; at the end of the frame the whole
+ * stream is uploaded once and each run is drawn from it, in submission order.
+ */
+class SpriteBatch
+{
+private:
+    // A stretch of the stream drawn with one texture
+    struct Run
+    {
+        GLuint texture_id;
+        int    first, count; // in vertices
+    };
+
+    ShaderProgram* m_program;
+    StreamBuffer   m_stream;
+
+    std::vector<float> m_vertices; // x, y, z, u, v for each vertex
+    std::vector<Run>   m_runs;
+
+    // ————— STATISTICS ————— //
+    int m_draw_calls   = 0,
+        m_sprite_count = 0;
+
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr int FLOATS_PER_VERTEX   = 5,
+                         VERTEX_SIZE         = FLOATS_PER_VERTEX * sizeof(float),
+                         VERTICES_PER_SPRITE = 6; // two triangles
+
+    // Appends the two triangles of one quad, in the layout below, to vertices
+    static void append_quad(std::vector<float> &vertices, const Transform2D &transform, glm::vec2 uv_offset,
+                            glm::vec2 uv_size);
+
+    // The x and y extent of the quad append_quad would draw for transform
+    static AABB get_quad_bounds(const Transform2D &transform);
+
+    // Appends prebuilt vertices in that layout, moved by offset
+    static void append_mesh(std::vector<float> &vertices, const std::vector<float> &mesh, glm::vec3 offset);
+
+    // Points program's attributes at that layout in the bound buffer, from offset 0
+    static void set_vertex_layout(ShaderProgram* program);
+
+    // ————— METHODS ————— //
+    explicit SpriteBatch(ShaderProgram* program);
+
+    // Sets up the program and vertex layout once for every draw until end(). A frame
+    // may hold several begin()/end() pairs, with other drawing in between.
+    void begin();
+
+    // Queues the unit quad centred on the origin, transformed by transform, showing the
+    // part of the texture starting at uv_offset and uv_size across
+    void draw(GLuint texture_id, const Transform2D &transform, glm::vec2 uv_offset = glm::vec2(0.0f),
+              glm::vec2 uv_size = glm::vec2(1.0f));
+
+    // Queues vertices already in the batch's layout, such as a TextCache mesh, moved by offset
+    void draw_mesh(GLuint texture_id, const std::vector<float> &mesh, glm::vec3 offset);
+
+    // Uploads whatever is queued and draws it; end() does this for you
+    void flush();
+    void end();
+
+    // The counters add up across begin()/end() pairs until reset, once per frame
+    void reset_counters();
+
+    // ————— GETTERS ————— //
+    int const get_draw_calls()   const { return m_draw_calls;   }
+    int const get_sprite_count() const { return m_sprite_count; }
+    StreamBuffer* const get_stream() { return &m_stream; }
+};
+
+#endif // SPRITE_BATCH_H
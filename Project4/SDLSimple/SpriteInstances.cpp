@@ -0,0 +1,154 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <algorithm>
+#include <cstring>
+#include "SpriteInstances.h"
+#include "SpriteBatch.h"
+
+constexpr int INSTANCE_SIZE = SpriteInstances::FLOATS_PER_INSTANCE * sizeof(float);
+constexpr int QUAD_VERTEX_SIZE = 4 * sizeof(float);
+
+// The unit quad, with the same corners, winding and v direction as SpriteBatch
+constexpr float QUAD_VERTICES[] =
+{
+    -0.5f, -0.5f, 0.0f, 1.0f,    0.5f, -0.5f, 1.0f, 1.0f,    0.5f,  0.5f, 1.0f, 0.0f,
+    -0.5f, -0.5f, 0.0f, 1.0f,    0.5f,  0.5f, 1.0f, 0.0f,   -0.5f,  0.5f, 0.0f, 0.0f
+};
+
+bool const SpriteInstances::is_supported()
+{
+    // Core from GL 3.3; on the 2.1 context both halves come from ARB extensions
+    const char *extensions = (const char*) glGetString(GL_EXTENSIONS);
+    return extensions != NULL &&
+           strstr(extensions, "GL_ARB_instanced_arrays") != NULL &&
+           strstr(extensions, "GL_ARB_draw_instanced")   != NULL;
+}
+
+SpriteInstances::SpriteInstances(ShaderProgram* program) : m_program(program)
+{
+    GLuint program_id = m_program->get_program_id();
+    m_row_x_attribute = glGetAttribLocation(program_id, "instanceRowX");
+    m_row_y_attribute = glGetAttribLocation(program_id, "instanceRowY");
+    m_row_z_attribute = glGetAttribLocation(program_id, "instanceRowZ");
+    m_uv_attribute    = glGetAttribLocation(program_id, "instanceUV");
+
+    glGenBuffers(1, &m_quad_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_quad_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD_VERTICES), QUAD_VERTICES, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &m_instance_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+SpriteInstances::~SpriteInstances()
+{
+    glDeleteBuffers(1, &m_quad_buffer);
+    glDeleteBuffers(1, &m_instance_buffer);
+}
+
+void SpriteInstances::add(GLuint texture_id, const Transform2D &transform, glm::vec2 uv_offset, glm::vec2 uv_size)
+{
+    int first = get_instance_count();
+    if (m_runs.empty() || m_runs.back().texture_id != texture_id) m_runs.push_back({ texture_id, first, 0 });
+    m_runs.back().count++;
+
+    // The rows of the 4x4 model matrix the transform stands for; sprites are flat, so
+    // the third column never reaches the shader's result
+    m_instances.insert(m_instances.end(), {
+        transform.a,  transform.c,  0.0f, transform.tx,
+        transform.b,  transform.d,  0.0f, transform.ty,
+        transform.zx, transform.zy, 0.0f, 0.0f,
+        uv_offset.x, uv_offset.y, uv_size.x, uv_size.y
+    });
+    m_visibility.add(SpriteBatch::get_quad_bounds(transform));
+}
+
+void SpriteInstances::upload()
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+    glBufferData(GL_ARRAY_BUFFER, m_instances.size() * sizeof(float), m_instances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_visibility.build();
+}
+
+void SpriteInstances::set_instance_pointers(int first)
+{
+    // Without a base instance in GL 2.1, each run points the attributes at its own
+    // first instance instead
+    size_t base = (size_t) first * INSTANCE_SIZE;
+
+    glVertexAttribPointer(m_row_x_attribute, 4, GL_FLOAT, false, INSTANCE_SIZE, (const void*) base);
+    glVertexAttribPointer(m_row_y_attribute, 4, GL_FLOAT, false, INSTANCE_SIZE, (const void*) (base + 4  * sizeof(float)));
+    glVertexAttribPointer(m_row_z_attribute, 4, GL_FLOAT, false, INSTANCE_SIZE, (const void*) (base + 8  * sizeof(float)));
+    glVertexAttribPointer(m_uv_attribute,    4, GL_FLOAT, false, INSTANCE_SIZE, (const void*) (base + 12 * sizeof(float)));
+}
+
+void SpriteInstances::render(const AABB &view)
+{
+    m_visibility.query(view, m_visible);
+    if (m_visible.empty()) return;
+
+    GLint instance_attributes[] = { m_row_x_attribute, m_row_y_attribute, m_row_z_attribute, m_uv_attribute };
+
+    m_program->use();
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_quad_buffer);
+    glVertexAttribPointer(m_program->get_position_attribute(), 2, GL_FLOAT, false, QUAD_VERTEX_SIZE, (const void*) 0);
+    glEnableVertexAttribArray(m_program->get_position_attribute());
+    glVertexAttribPointer(m_program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, QUAD_VERTEX_SIZE,
+                          (const void*) (2 * sizeof(float)));
+    glEnableVertexAttribArray(m_program->get_tex_coordinate_attribute());
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+    for (GLint attribute : instance_attributes)
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisorARB(attribute, 1);
+    }
+
+    // Both lists are sorted, so each run picks up where the last one stopped
+    size_t range = 0;
+    for (const Run &run : m_runs)
+    {
+        int run_end = run.first + run.count;
+        bool is_bound = false;
+
+        for (; range < m_visible.size(); range++)
+        {
+            int range_end = m_visible[range].first + m_visible[range].count;
+            if (m_visible[range].first >= run_end) break;
+
+            if (!is_bound)
+            {
+                glBindTexture(GL_TEXTURE_2D, run.texture_id);
+                is_bound = true;
+            }
+
+            int first = std::max(m_visible[range].first, run.first),
+                count = std::min(range_end, run_end) - first;
+            set_instance_pointers(first);
+            glDrawArraysInstancedARB(GL_TRIANGLES, 0, 6, count);
+            m_draw_calls++;
+            m_drawn_instances += count;
+
+            // A range running on into the next run is picked up again there
+            if (range_end > run_end) break;
+        }
+    }
+
+    // Divisors are not part of the program, so they would leak into the next draw
+    for (GLint attribute : instance_attributes)
+    {
+        glVertexAttribDivisorARB(attribute, 0);
+        glDisableVertexAttribArray(attribute);
+    }
+    glDisableVertexAttribArray(m_program->get_position_attribute());
+    glDisableVertexAttribArray(m_program->get_tex_coordinate_attribute());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,78 @@
+#ifndef SPRITE_INSTANCES_H
+#define SPRITE_INSTANCES_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "ShaderProgram.h"
+#include "Transform2D.h"
+#include "VisibilityIndex.h"
+
+/**
+ * A fixed set of sprites drawn with instancing: one shared unit quad plus a buffer
+ * holding each sprite's model matrix rows and UV rectangle. Sprites are added once,
+ * uploaded once, and then cost one instanced draw per visible stretch of a run
+ * of the same texture, found through a VisibilityIndex. Needs a program built from vertex_textured_instanced.glsl.
+ */
+class SpriteInstances
+{
+private:
+    // Consecutive instances sharing a texture
+    struct Run
+    {
+        GLuint texture_id;
+        int    first, count; // in instances
+    };
+
+    ShaderProgram* m_program;
+
+    GLuint m_quad_buffer     = 0,
+           m_instance_buffer = 0;
+
+    GLint m_row_x_attribute,
+          m_row_y_attribute,
+          m_row_z_attribute,
+          m_uv_attribute;
+
+    std::vector<float> m_instances;
+    std::vector<Run>   m_runs;
+
+    VisibilityIndex                     m_visibility;
+    std::vector<VisibilityIndex::Range> m_visible;
+
+    // ————— STATISTICS ————— //
+    int m_draw_calls      = 0,
+        m_drawn_instances = 0;
+
+    void set_instance_pointers(int first);
+
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr int FLOATS_PER_INSTANCE = 16; // three matrix rows and a UV rectangle
+
+    // ————— METHODS ————— //
+    // Whether the current context has instanced arrays; check before constructing
+    static bool const is_supported();
+
+    explicit SpriteInstances(ShaderProgram* program);
+    ~SpriteInstances();
+
+    // Same arguments as SpriteBatch::draw, but kept until the set is destroyed
+    void add(GLuint texture_id, const Transform2D &transform, glm::vec2 uv_offset = glm::vec2(0.0f),
+             glm::vec2 uv_size = glm::vec2(1.0f));
+
+    // Copies the added sprites to the GPU; call once after the last add()
+    void upload();
+
+    // Draws the sprites that overlap view, then leaves the attribute state as the
+    // sprite batch expects
+    void render(const AABB &view);
+
+    void reset_counters() { m_draw_calls = 0; m_drawn_instances = 0; }
+
+    // ————— GETTERS ————— //
+    int const get_draw_calls()      const { return m_draw_calls; }
+    int const get_instance_count()  const { return (int) (m_instances.size() / FLOATS_PER_INSTANCE); }
+    int const get_drawn_instances() const { return m_drawn_instances; }
+};
+
+#endif // SPRITE_INSTANCES_H
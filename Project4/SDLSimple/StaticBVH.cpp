@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include "StaticBVH.h"
+
+// Queries are grown by this much so that boxes that only touch the query after
+// rounding still reach the narrowphase.
+constexpr float QUERY_PADDING = 1.0e-4f;
+
+// Median splits give a node of c boxes children of floor(c / 2) and ceil(c / 2), and only
+// nodes above MAX_LEAF_SIZE split, so a node at depth d holds at most ceil(n / 2^d) boxes
+// and the deepest leaf sits at depth D = ceil(log2(n / MAX_LEAF_SIZE)). Popping a node
+// pushes its two children, leaving at most one waiting sibling per level above it, so
+// the stack never holds more than D + 1 nodes. Box counts fit in an int, so D <= 29
+// and 64 leaves room to spare; the assert in query() checks it in debug builds.
+constexpr int TRAVERSAL_STACK_SIZE = 64;
+
+static AABB merge(const AABB &a, const AABB &b)
+{
+    return { std::min(a.min_x, b.min_x), std::min(a.min_y, b.min_y),
+             std::max(a.max_x, b.max_x), std::max(a.max_y, b.max_y) };
+}
+
+void StaticBVH::build(const std::vector<AABB> &boxes)
+{
+    m_nodes.clear();
+    m_boxes.clear();
+    m_indices.resize(boxes.size());
+    for (int i = 0; i < (int) boxes.size(); i++) m_indices[i] = i;
+
+    if (boxes.empty()) return;
+
+    // Every leaf holds at least one box, so there are at most n leaves, and a binary tree
+    // with L leaves has 2L - 1 nodes: 2n is an upper bound however full the leaves are
+    m_nodes.reserve(2 * boxes.size());
+    m_nodes.push_back({ AABB(), 0, (int) boxes.size() });
+    subdivide(boxes, 0);
+
+    // Copy the boxes into leaf order so that leaves are scanned contiguously
+    m_boxes.reserve(boxes.size());
+    for (int index : m_indices) m_boxes.push_back(boxes[index]);
+}
+
+void StaticBVH::subdivide(const std::vector<AABB> &boxes, int node_index)
+{
+    Node node = m_nodes[node_index];
+
+    AABB bounds = boxes[m_indices[node.first]];
+    float centre_min_x = (bounds.min_x + bounds.max_x) / 2.0f, centre_max_x = centre_min_x,
+          centre_min_y = (bounds.min_y + bounds.max_y) / 2.0f, centre_max_y = centre_min_y;
+
+    for (int i = node.first; i < node.first + node.count; i++)
+    {
+        const AABB &box = boxes[m_indices[i]];
+        bounds = merge(bounds, box);
+
+        float centre_x = (box.min_x + box.max_x) / 2.0f,
+              centre_y = (box.min_y + box.max_y) / 2.0f;
+        centre_min_x = std::min(centre_min_x, centre_x); centre_max_x = std::max(centre_max_x, centre_x);
+        centre_min_y = std::min(centre_min_y, centre_y); centre_max_y = std::max(centre_max_y, centre_y);
+    }
+    m_nodes[node_index].bounds = bounds;
+
+    if (node.count <= MAX_LEAF_SIZE) return;
+
+    // Median split along the axis where the box centres are most spread out
+    bool split_x = (centre_max_x - centre_min_x) >= (centre_max_y - centre_min_y);
+    int  half    = node.count / 2;
+
+    auto first = m_indices.begin() + node.first;
+    std::nth_element(first, first + half, first + node.count, [&](int a, int b)
+    {
+        const AABB &box_a = boxes[a], &box_b = boxes[b];
+        return split_x ? box_a.min_x + box_a.max_x < box_b.min_x + box_b.max_x
+                       : box_a.min_y + box_a.max_y < box_b.min_y + box_b.max_y;
+    });
+
+    int left = (int) m_nodes.size();
+    m_nodes.push_back({ AABB(), node.first, half });
+    m_nodes.push_back({ AABB(), node.first + half, node.count - half });
+
+    m_nodes[node_index].first = left;
+    m_nodes[node_index].count = 0;
+
+    subdivide(boxes, left);
+    subdivide(boxes, left + 1);
+}
+
+void StaticBVH::query(const AABB &bounds, std::vector<int> &out) const
+{
+    out.clear();
+    if (m_nodes.empty()) return;
+
+    AABB padded = { bounds.min_x - QUERY_PADDING, bounds.min_y - QUERY_PADDING,
+                    bounds.max_x + QUERY_PADDING, bounds.max_y + QUERY_PADDING };
+
+    int stack[TRAVERSAL_STACK_SIZE];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0)
+    {
+        const Node &node = m_nodes[stack[--stack_size]];
+        if (!node.bounds.overlaps(padded)) continue;
+
+        if (node.count == 0)
+        {
+            assert(stack_size + 2 <= TRAVERSAL_STACK_SIZE);
+            stack[stack_size++] = node.first;
+            stack[stack_size++] = node.first + 1;
+            continue;
+        }
+
+        for (int i = node.first; i < node.first + node.count; i++)
+            if (m_boxes[i].overlaps(padded)) out.push_back(m_indices[i]);
+    }
+
+    std::sort(out.begin(), out.end());
+
+    if (m_validate)
+    {
+        std::vector<int> expected;
+        brute_force_query(padded, expected);
+        if (expected != out)
+        {
+            std::cout << "StaticBVH: query returned " << out.size() << " boxes, linear scan found "
+                      << expected.size() << std::endl;
+            std::abort();
+        }
+    }
+}
+
+void StaticBVH::brute_force_query(const AABB &bounds, std::vector<int> &out) const
+{
+    out.clear();
+    for (int i = 0; i < (int) m_boxes.size(); i++)
+        if (m_boxes[i].overlaps(bounds)) out.push_back(m_indices[i]);
+
+    std::sort(out.begin(), out.end());
+}
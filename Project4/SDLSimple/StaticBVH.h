@@ -0,0 +1,49 @@
+#ifndef STATIC_BVH_H
+#define STATIC_BVH_H
+
+#include <vector>
+#include "Broadphase.h"
+
+/**
+ * Read-only bounding volume hierarchy over geometry that never moves. Built once
+ * at level load into a flat node array: a node's children sit next to each other,
+ * and every leaf owns a contiguous run of the reordered boxes.
+ */
+class StaticBVH : public Broadphase
+{
+private:
+    struct Node
+    {
+        AABB bounds;
+        int  first; // first box for leaves, left child for inner nodes
+        int  count; // 0 for inner nodes
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<AABB> m_boxes;   // in leaf order
+    std::vector<int>  m_indices; // leaf order -> original index
+
+    bool m_validate = false;
+
+    void subdivide(const std::vector<AABB> &boxes, int node_index);
+    void brute_force_query(const AABB &bounds, std::vector<int> &out) const;
+
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr int MAX_LEAF_SIZE = 4;
+
+    // ————— METHODS ————— //
+    void build(const std::vector<AABB> &boxes);
+    void query(const AABB &bounds, std::vector<int> &out) const override;
+
+    // ————— GETTERS ————— //
+    int  const get_node_count() const { return (int) m_nodes.size(); }
+    int  const get_box_count()  const { return (int) m_boxes.size(); }
+    bool const get_validate()   const { return m_validate; }
+
+    // ————— SETTERS ————— //
+    // Checks every query against a linear scan of the same boxes and aborts on a mismatch
+    void const set_validate(bool validate) { m_validate = validate; }
+};
+
+#endif // STATIC_BVH_H
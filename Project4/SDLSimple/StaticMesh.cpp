@@ -0,0 +1,85 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <algorithm>
+#include "StaticMesh.h"
+#include "SpriteBatch.h"
+
+StaticMesh::StaticMesh(ShaderProgram* program) : m_program(program) { }
+
+StaticMesh::~StaticMesh()
+{
+    if (m_buffer != 0) glDeleteBuffers(1, &m_buffer);
+}
+
+void StaticMesh::add(GLuint texture_id, const Transform2D &transform, glm::vec2 uv_offset, glm::vec2 uv_size)
+{
+    int first = (int) (m_vertices.size() / SpriteBatch::FLOATS_PER_VERTEX);
+    if (m_runs.empty() || m_runs.back().texture_id != texture_id) m_runs.push_back({ texture_id, first, 0 });
+    m_runs.back().count += SpriteBatch::VERTICES_PER_SPRITE;
+
+    SpriteBatch::append_quad(m_vertices, transform, uv_offset, uv_size);
+    m_visibility.add(SpriteBatch::get_quad_bounds(transform));
+    m_sprite_count++;
+}
+
+void StaticMesh::bake()
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(float), m_vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    std::vector<float>().swap(m_vertices);
+    m_visibility.build();
+}
+
+void StaticMesh::render(const AABB &view)
+{
+    m_visibility.query(view, m_visible);
+    if (m_visible.empty()) return;
+
+    m_program->use();
+    m_program->set_model_matrix(glm::mat4(1.0f));
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    SpriteBatch::set_vertex_layout(m_program);
+
+    // Both lists are sorted, so each run picks up where the last one stopped
+    size_t range = 0;
+    for (const Run &run : m_runs)
+    {
+        int run_end = run.first + run.count;
+
+        m_firsts.clear();
+        m_counts.clear();
+        for (; range < m_visible.size(); range++)
+        {
+            int range_first = m_visible[range].first * SpriteBatch::VERTICES_PER_SPRITE,
+                range_end   = range_first + m_visible[range].count * SpriteBatch::VERTICES_PER_SPRITE;
+            if (range_first >= run_end) break;
+
+            int first = std::max(range_first, run.first),
+                end   = std::min(range_end, run_end);
+            m_firsts.push_back(first);
+            m_counts.push_back(end - first);
+            m_drawn_sprites += (end - first) / SpriteBatch::VERTICES_PER_SPRITE;
+
+            // A range running on into the next run is picked up again there
+            if (range_end > run_end) break;
+        }
+        if (m_firsts.empty()) continue;
+
+        glBindTexture(GL_TEXTURE_2D, run.texture_id);
+        glMultiDrawArrays(GL_TRIANGLES, m_firsts.data(), m_counts.data(), (GLsizei) m_firsts.size());
+        m_draw_calls++;
+    }
+
+    glDisableVertexAttribArray(m_program->get_position_attribute());
+    glDisableVertexAttribArray(m_program->get_tex_coordinate_attribute());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,67 @@
+#ifndef STATIC_MESH_H
+#define STATIC_MESH_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "ShaderProgram.h"
+#include "Transform2D.h"
+#include "VisibilityIndex.h"
+
+/**
+ * Sprites that never move, baked once into world space and kept in a static vertex
+ * buffer in SpriteBatch's layout. Drawing them takes no CPU work beyond one draw
+ * per run of the same texture, with the program's model matrix at identity.
+ * Sprites outside the view are skipped by looking them up in a VisibilityIndex.
+ */
+class StaticMesh
+{
+private:
+    // Consecutive sprites sharing a texture
+    struct Run
+    {
+        GLuint texture_id;
+        int    first, count; // in vertices
+    };
+
+    ShaderProgram* m_program;
+    GLuint         m_buffer = 0;
+
+    std::vector<float> m_vertices; // only kept until bake()
+    std::vector<Run>   m_runs;
+
+    VisibilityIndex                     m_visibility;
+    std::vector<VisibilityIndex::Range> m_visible;
+    std::vector<GLint>                  m_firsts; // one run's visible ranges, in vertices
+    std::vector<GLsizei>                m_counts;
+
+    int m_sprite_count = 0;
+
+    // ————— STATISTICS ————— //
+    int m_draw_calls    = 0,
+        m_drawn_sprites = 0;
+
+public:
+    // ————— METHODS ————— //
+    explicit StaticMesh(ShaderProgram* program);
+    ~StaticMesh();
+
+    // Same arguments as SpriteBatch::draw
+    void add(GLuint texture_id, const Transform2D &transform, glm::vec2 uv_offset = glm::vec2(0.0f),
+             glm::vec2 uv_size = glm::vec2(1.0f));
+
+    // Uploads everything added and frees the CPU copy; call once after the last add()
+    void bake();
+
+    // Draws the sprites that overlap view, one multi-draw per run that has any; the
+    // sprite batch must not be between begin() and end()
+    void render(const AABB &view);
+
+    void reset_counters() { m_draw_calls = 0; m_drawn_sprites = 0; }
+
+    // ————— GETTERS ————— //
+    int const get_draw_calls()    const { return m_draw_calls;    }
+    int const get_sprite_count()  const { return m_sprite_count;  }
+    int const get_drawn_sprites() const { return m_drawn_sprites; }
+};
+
+#endif // STATIC_MESH_H
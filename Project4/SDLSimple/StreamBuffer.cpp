@@ -0,0 +1,56 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include "StreamBuffer.h"
+
+StreamBuffer::StreamBuffer(int capacity) : m_capacity(capacity) { }
+
+StreamBuffer::~StreamBuffer()
+{
+    if (m_buffer != 0) glDeleteBuffers(1, &m_buffer);
+}
+
+void StreamBuffer::bind()
+{
+    if (m_buffer == 0)
+    {
+        glGenBuffers(1, &m_buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferData(GL_ARRAY_BUFFER, m_capacity, NULL, GL_STREAM_DRAW);
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+}
+
+void StreamBuffer::orphan()
+{
+    // Same size and usage, no data: the driver can swap in new storage instead of
+    // waiting for draws still reading the old one
+    glBufferData(GL_ARRAY_BUFFER, m_capacity, NULL, GL_STREAM_DRAW);
+    m_cursor = 0;
+    m_orphan_count++;
+}
+
+int StreamBuffer::write(const void *data, int size)
+{
+    bind();
+
+    if (size > m_capacity)
+    {
+        while (m_capacity < size) m_capacity *= 2;
+        orphan();
+    }
+    else if (m_cursor + size > m_capacity) orphan();
+
+    int offset = m_cursor;
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    m_cursor += size;
+    m_bytes_written += size;
+
+    return offset;
+}
@@ -0,0 +1,48 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "ShaderProgram.h"
+
+/**
+ * A dynamic vertex buffer written as a ring. Each write lands after the previous
+ * one, so the GPU can still be reading earlier data while new data goes in. When
+ * the ring is full the buffer is orphaned: the driver hands back fresh storage and
+ * frees the old storage once the GPU is done with it, so writes never wait.
+ */
+class StreamBuffer
+{
+private:
+    GLuint m_buffer   = 0; // created on first use, once there is a GL context
+    int    m_capacity = 0, // in bytes
+           m_cursor   = 0;
+
+    // ————— STATISTICS ————— //
+    int m_orphan_count  = 0,
+        m_bytes_written = 0;
+
+    void orphan();
+
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr int DEFAULT_CAPACITY = 256 * 1024;
+
+    // ————— METHODS ————— //
+    explicit StreamBuffer(int capacity = DEFAULT_CAPACITY);
+    ~StreamBuffer();
+
+    void bind();
+
+    // Copies size bytes into the ring and returns the byte offset they start at. The
+    // buffer is left bound. size should be a multiple of the vertex size so that
+    // offsets always fall on a whole vertex.
+    int write(const void *data, int size);
+
+    void reset_counters() { m_bytes_written = 0; }
+
+    // ————— GETTERS ————— //
+    int const get_capacity()      const { return m_capacity;      }
+    int const get_orphan_count()  const { return m_orphan_count;  }
+    int const get_bytes_written() const { return m_bytes_written; }
+};
+
+#endif // STREAM_BUFFER_H
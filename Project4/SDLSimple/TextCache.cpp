@@ -0,0 +1,69 @@
+#include "TextCache.h"
+#include "SpriteBatch.h"
+
+TextCache::TextCache()
+{
+    for (std::vector<float> &scratch : m_scratch)
+        scratch.reserve(SCRATCH_GLYPHS * SpriteBatch::VERTICES_PER_SPRITE * SpriteBatch::FLOATS_PER_VERTEX);
+}
+
+void TextCache::build_mesh(std::vector<float> &vertices, const AtlasRegion &font, const char *text,
+                           float font_size, float spacing)
+{
+    // Scale the size of the fontbank in the UV-plane
+    // We will use this for spacing and positioning
+    float width = 1.0f / FONTBANK_SIZE;
+    float height = 1.0f / FONTBANK_SIZE;
+
+    vertices.clear();
+
+    // For every character...
+    for (int i = 0; text[i] != '\0'; i++) {
+        // 1. Get their index in the spritesheet, as well as their offset (i.e. their
+        //    position relative to the whole sentence)
+        int spritesheet_index = (int) text[i];  // ascii value of character
+        float offset = (font_size + spacing) * i;
+
+        // 2. Using the spritesheet index, we can calculate our U- and V-coordinates
+        float u_coordinate = (float) (spritesheet_index % FONTBANK_SIZE) / FONTBANK_SIZE;
+        float v_coordinate = (float) (spritesheet_index / FONTBANK_SIZE) / FONTBANK_SIZE;
+
+        // 3. Add a font_size square for it, moving its UVs into wherever the
+        //    fontbank sits in its texture
+        Transform2D transform = Transform2D::make(glm::vec2(offset, 0.0f), 0.0f, glm::vec3(0.0f, 0.0f, 1.0f),
+                                                  glm::vec2(font_size));
+
+        SpriteBatch::append_quad(vertices, transform,
+                                 font.uv_offset + glm::vec2(u_coordinate, v_coordinate) * font.uv_size,
+                                 glm::vec2(width, height) * font.uv_size);
+    }
+}
+
+const std::vector<float> &TextCache::get_mesh(const AtlasRegion &font, const char *text, float font_size,
+                                              float spacing)
+{
+    for (const Entry &entry : m_entries)
+    {
+        if (entry.text == text && entry.font_size == font_size && entry.spacing == spacing &&
+            entry.font.texture_id == font.texture_id && entry.font.uv_offset == font.uv_offset &&
+            entry.font.uv_size == font.uv_size)
+        {
+            m_hits++;
+            return entry.vertices;
+        }
+    }
+
+    m_misses++;
+    m_entries.push_back({ text, font_size, spacing, font, std::vector<float>() });
+    build_mesh(m_entries.back().vertices, font, text, font_size, spacing);
+    return m_entries.back().vertices;
+}
+
+const std::vector<float> &TextCache::get_scratch_mesh(const AtlasRegion &font, const char *text, float font_size,
+                                                      float spacing, int slot)
+{
+    // clear() keeps the capacity, so this only allocates for a string longer than
+    // any before it and SCRATCH_GLYPHS
+    build_mesh(m_scratch[slot], font, text, font_size, spacing);
+    return m_scratch[slot];
+}
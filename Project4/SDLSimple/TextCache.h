@@ -0,0 +1,63 @@
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include "TextureAtlas.h"
+
+/**
+ * Glyph quads for strings drawn with the fontbank, built relative to the start of
+ * the string in SpriteBatch's vertex layout. Text that stays the same is built
+ * once and kept, keyed by its string, font size and spacing. Text that changes
+ * every frame goes through a numbered scratch mesh instead, which reuses its storage.
+ */
+class TextCache
+{
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr int FONTBANK_SIZE  = 16,
+                         SCRATCH_GLYPHS = 64, // longest dynamic string laid out without growing
+                         SCRATCH_SLOTS  = 16; // dynamic strings that can be in one frame
+
+private:
+    struct Entry
+    {
+        std::string        text;
+        float              font_size, spacing;
+        AtlasRegion        font;
+        std::vector<float> vertices;
+    };
+
+    // Searched in order: a game shows a handful of strings, and comparing against a
+    // const char* never allocates, where building a key to hash would. A deque, so
+    // that adding a string leaves the meshes already handed out where they are.
+    std::deque<Entry>  m_entries;
+    std::vector<float> m_scratch[SCRATCH_SLOTS];
+
+    // ————— STATISTICS ————— //
+    int m_hits = 0, m_misses = 0;
+
+public:
+    // ————— METHODS ————— //
+    TextCache();
+
+    // Lays text out into vertices, replacing what was there
+    static void build_mesh(std::vector<float> &vertices, const AtlasRegion &font, const char *text,
+                           float font_size, float spacing);
+
+    // The mesh for text that does not change; built on the first call only
+    const std::vector<float> &get_mesh(const AtlasRegion &font, const char *text, float font_size, float spacing);
+
+    // The mesh for text that does; rebuilt every call, and only valid until the next
+    // call for the same slot
+    const std::vector<float> &get_scratch_mesh(const AtlasRegion &font, const char *text, float font_size,
+                                               float spacing, int slot = 0);
+
+    // ————— GETTERS ————— //
+    int const get_hits()        const { return m_hits;   }
+    int const get_misses()      const { return m_misses; }
+    int const get_entry_count() const { return (int) m_entries.size(); }
+};
+
+#endif // TEXT_CACHE_H
@@ -0,0 +1,196 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "stb_image.h"
+#include "TextureAtlas.h"
+#include "TextureImporter.h"
+
+#define LOG(argument) std::cout << argument << '\n'
+
+constexpr int BYTES_PER_PIXEL = 4;
+
+// Page sizes tried in turn until one holds every image left
+constexpr int PAGE_SIZES[][2] = { { 256, 256 }, { 512, 256 }, { 512, 512 }, { 1024, 512 }, { 1024, 1024 },
+                                  { 2048, 1024 }, { 2048, 2048 } };
+
+TextureAtlas::TextureAtlas(bool packing) : m_packing(packing) { }
+
+TextureAtlas::~TextureAtlas()
+{
+    for (GLuint page : m_pages) TextureImporter::forget(page);
+    if (!m_pages.empty()) glDeleteTextures((GLsizei) m_pages.size(), m_pages.data());
+}
+
+int TextureAtlas::add(const char* filepath, glm::ivec2 max_size)
+{
+    assert(!m_is_built);
+
+    Image image;
+    int number_of_components;
+    image.filepath = filepath;
+    image.page     = -1;
+
+    unsigned char* pixels = stbi_load(filepath, &image.width, &image.height, &number_of_components, STBI_rgb_alpha);
+    if (pixels == NULL)
+    {
+        LOG("Unable to load image. Make sure the path is correct.");
+        assert(false);
+    }
+
+    image.pixels.assign(pixels, pixels + image.width * image.height * BYTES_PER_PIXEL);
+    stbi_image_free(pixels);
+    TextureImporter::downscale(image.pixels, image.width, image.height, BYTES_PER_PIXEL, max_size);
+
+    m_images.push_back(image);
+    m_regions.push_back(AtlasRegion());
+    return (int) m_images.size() - 1;
+}
+
+int TextureAtlas::shelf_pack(const std::vector<int> &order, int page, int width, int height, bool place)
+{
+    int x = 0, y = 0, shelf_height = 0, placed = 0;
+
+    for (int index : order)
+    {
+        Image &image = m_images[index];
+        if (image.page != -1) continue;
+
+        int slot_width  = image.width  + 2 * PADDING,
+            slot_height = image.height + 2 * PADDING;
+
+        // Tallest first, so a new shelf is never taller than the one before it
+        if (x + slot_width > width)
+        {
+            x = 0;
+            y += shelf_height;
+            shelf_height = 0;
+        }
+        if (slot_width > width || y + slot_height > height) continue;
+
+        if (place)
+        {
+            image.page = page;
+            image.x    = x + PADDING;
+            image.y    = y + PADDING;
+        }
+        x += slot_width;
+        shelf_height = std::max(shelf_height, slot_height);
+        placed++;
+    }
+
+    return placed;
+}
+
+void TextureAtlas::upload_page(int page, int width, int height, int padding)
+{
+    // Unused space stays transparent
+    std::vector<unsigned char> pixels(width * height * BYTES_PER_PIXEL, 0);
+
+    for (Image &image : m_images)
+    {
+        if (image.page != page) continue;
+
+        // Each row of the frame repeats the nearest pixel of the image, which also
+        // fills the corners from the image's corners
+        for (int row = -padding; row < image.height + padding; row++)
+        {
+            int source_row = std::min(std::max(row, 0), image.height - 1);
+            for (int column = -padding; column < image.width + padding; column++)
+            {
+                int source_column = std::min(std::max(column, 0), image.width - 1);
+                memcpy(&pixels[((image.y + row) * width + image.x + column) * BYTES_PER_PIXEL],
+                       &image.pixels[(source_row * image.width + source_column) * BYTES_PER_PIXEL],
+                       BYTES_PER_PIXEL);
+            }
+        }
+
+        AtlasRegion &region = m_regions[&image - m_images.data()];
+        region.uv_offset = glm::vec2((float) image.x / width, (float) image.y / height);
+        region.uv_size   = glm::vec2((float) image.width / width, (float) image.height / height);
+    }
+
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    for (Image &image : m_images) if (image.page == page) m_regions[&image - m_images.data()].texture_id = texture_id;
+
+    m_pages.push_back(texture_id);
+    m_page_sizes.push_back(glm::ivec2(width, height));
+
+    // A page of its own is named after its image
+    std::string name = "atlas page " + std::to_string(page);
+    if (padding == 0)
+        for (const Image &image : m_images) if (image.page == page) name = image.filepath;
+    TextureImporter::record(name.c_str(), texture_id, width, height, TEXTURE_RGBA, false);
+}
+
+void TextureAtlas::build()
+{
+    assert(!m_is_built);
+    m_is_built = true;
+
+    GLint max_texture_size;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    int max_page_size = std::min(MAX_PAGE_SIZE, (int) max_texture_size);
+
+    std::vector<int> order;
+    for (int i = 0; i < (int) m_images.size(); i++)
+    {
+        Image &image = m_images[i];
+
+        // Anything too big to share a page, or everything when not packing, is
+        // uploaded on its own at its own size with no frame
+        if (!m_packing || image.width + 2 * PADDING > max_page_size || image.height + 2 * PADDING > max_page_size)
+        {
+            image.page = (int) m_pages.size();
+            image.x    = 0;
+            image.y    = 0;
+            upload_page(image.page, image.width, image.height, 0);
+        }
+        else order.push_back(i);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return m_images[a].height > m_images[b].height;
+    });
+
+    int remaining = (int) order.size();
+    while (remaining > 0)
+    {
+        int page   = (int) m_pages.size(),
+            width  = max_page_size,
+            height = max_page_size;
+
+        for (const int (&size)[2] : PAGE_SIZES)
+        {
+            if (size[0] > max_page_size || size[1] > max_page_size) break;
+            if (shelf_pack(order, page, size[0], size[1], false) == remaining)
+            {
+                width  = size[0];
+                height = size[1];
+                break;
+            }
+        }
+
+        // Whatever does not fit on the largest page waits for the next one
+        remaining -= shelf_pack(order, page, width, height, true);
+        upload_page(page, width, height, PADDING);
+    }
+
+    for (Image &image : m_images) std::vector<unsigned char>().swap(image.pixels);
+}
@@ -0,0 +1,67 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "ShaderProgram.h"
+
+// Where an image ended up: its page's texture and the rectangle it covers there, in
+// the same 0-1 UV space the image's own texture would have used
+struct AtlasRegion
+{
+    GLuint    texture_id = 0;
+    glm::vec2 uv_offset  = glm::vec2(0.0f),
+              uv_size    = glm::vec2(1.0f);
+};
+
+/**
+ * Packs images into as few textures ("pages") as it can at load time. Images are
+ * sorted tallest first and laid out on shelves, and each page is the smallest size
+ * that holds what is left, up to MAX_PAGE_SIZE. Every image is framed by a copy of
+ * its own edge pixels, so sampling right at its border never picks up a neighbour.
+ */
+class TextureAtlas
+{
+private:
+    struct Image
+    {
+        std::string                filepath;
+        int                        width, height;
+        std::vector<unsigned char> pixels; // RGBA, freed once packed
+        int                        page, x, y;
+    };
+
+    std::vector<Image>       m_images;
+    std::vector<AtlasRegion> m_regions;
+    std::vector<GLuint>      m_pages;
+    std::vector<glm::ivec2>  m_page_sizes;
+
+    bool m_packing;
+    bool m_is_built = false;
+
+    int shelf_pack(const std::vector<int> &order, int page, int width, int height, bool place);
+    void upload_page(int page, int width, int height, int padding);
+
+public:
+    // ————— STATIC VARIABLES ————— //
+    static constexpr int MAX_PAGE_SIZE = 2048, // every Mac that runs GL 2.1 manages this
+                         PADDING       = 2;
+
+    // ————— METHODS ————— //
+    // With packing off, each image gets a page of its own, exactly as if it were loaded alone
+    explicit TextureAtlas(bool packing = true);
+    ~TextureAtlas();
+
+    // Loads an image, shrunk to at most max_size if it is given, and returns its
+    // handle for get_region(); everything must be added before build()
+    int add(const char* filepath, glm::ivec2 max_size = glm::ivec2(0));
+    void build();
+
+    // ————— GETTERS ————— //
+    AtlasRegion const get_region(int handle) const { return m_regions[handle]; }
+    int         const get_page_count()       const { return (int) m_pages.size(); }
+    glm::ivec2  const get_page_size(int page) const { return m_page_sizes[page]; }
+};
+
+#endif // TEXTURE_ATLAS_H
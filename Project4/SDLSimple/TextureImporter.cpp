@@ -0,0 +1,163 @@
+#define GL_SILENCE_DEPRECATION
+
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+
+#define GL_GLEXT_PROTOTYPES 1
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include "stb_image.h"
+#include "TextureImporter.h"
+
+#define LOG(argument) std::cout << argument << '\n'
+
+constexpr double BYTES_PER_MEGABYTE = 1024.0 * 1024.0;
+
+std::vector<TextureImporter::LedgerEntry> TextureImporter::s_ledger;
+
+int const TextureImporter::get_channel_count(TextureFormat format)
+{
+    switch (format)
+    {
+        case TEXTURE_RGB:  return 3;
+        case TEXTURE_GREY: return 1;
+        default:           return 4;
+    }
+}
+
+GLuint TextureImporter::load(const char *filepath, const TextureImportSettings &settings)
+{
+    int width, height, number_of_components,
+        channels = get_channel_count(settings.format);
+    unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components, channels);
+
+    if (image == NULL)
+    {
+        LOG("Unable to load image. Make sure the path is correct.");
+        assert(false);
+    }
+
+    std::vector<unsigned char> pixels(image, image + width * height * channels);
+    stbi_image_free(image);
+    downscale(pixels, width, height, channels, settings.max_size);
+
+    // Legacy formats on the 2.1 context: a single channel reads back as grey
+    static const GLenum GL_FORMATS[] = { GL_RGBA, GL_RGB, GL_LUMINANCE };
+    GLenum gl_format = GL_FORMATS[settings.format];
+
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+
+    // Core since GL 1.4, so the driver builds the chain from level 0 on upload
+    if (settings.generate_mipmaps) glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+
+    // Rows of RGB and grey images are not always a multiple of four bytes long
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, gl_format, width, height, 0, gl_format, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    settings.generate_mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    record(filepath, texture_id, width, height, settings.format, settings.generate_mipmaps);
+    return texture_id;
+}
+
+bool TextureImporter::downscale(std::vector<unsigned char> &pixels, int &width, int &height, int channels,
+                                glm::ivec2 max_size)
+{
+    int new_width  = max_size.x > 0 ? std::min(width,  max_size.x) : width,
+        new_height = max_size.y > 0 ? std::min(height, max_size.y) : height;
+    if (new_width == width && new_height == height) return false;
+
+    std::vector<unsigned char> scaled(new_width * new_height * channels);
+    for (int y = 0; y < new_height; y++)
+    {
+        // The source rows and columns this pixel covers; at least one of each
+        int top    = y * height / new_height,
+            bottom = std::max((y + 1) * height / new_height, top + 1);
+
+        for (int x = 0; x < new_width; x++)
+        {
+            int left  = x * width / new_width,
+                right = std::max((x + 1) * width / new_width, left + 1);
+
+            int count = (bottom - top) * (right - left);
+            for (int channel = 0; channel < channels; channel++)
+            {
+                int sum = 0;
+                for (int row = top; row < bottom; row++)
+                    for (int column = left; column < right; column++)
+                        sum += pixels[(row * width + column) * channels + channel];
+
+                scaled[(y * new_width + x) * channels + channel] = (unsigned char) ((sum + count / 2) / count);
+            }
+        }
+    }
+
+    pixels.swap(scaled);
+    width  = new_width;
+    height = new_height;
+    return true;
+}
+
+void TextureImporter::record(const char *name, GLuint texture_id, int width, int height, TextureFormat format,
+                             bool has_mipmaps)
+{
+    LedgerEntry entry = { name, texture_id, width, height, 0, format, 0 };
+
+    // Each level halves both sides, down to 1x1
+    int level_width = width, level_height = height;
+    while (true)
+    {
+        entry.level_count++;
+        entry.byte_count += (long) level_width * level_height * get_channel_count(format);
+        if (!has_mipmaps || (level_width == 1 && level_height == 1)) break;
+
+        level_width  = std::max(level_width  / 2, 1);
+        level_height = std::max(level_height / 2, 1);
+    }
+
+    s_ledger.push_back(entry);
+}
+
+void TextureImporter::forget(GLuint texture_id)
+{
+    s_ledger.erase(std::remove_if(s_ledger.begin(), s_ledger.end(),
+                                  [&](const LedgerEntry &entry) { return entry.texture_id == texture_id; }),
+                   s_ledger.end());
+}
+
+long const TextureImporter::get_total_bytes()
+{
+    long total = 0;
+    for (const LedgerEntry &entry : s_ledger) total += entry.byte_count;
+    return total;
+}
+
+void TextureImporter::report(long budget)
+{
+    static const char* FORMAT_NAMES[] = { "RGBA", "RGB", "grey" };
+
+    char line[160];
+    snprintf(line, sizeof(line), "%-40s%-9s\t%s\t%s\t%s\n", "texture", "size", "format", "levels", "bytes");
+    std::cout << line;
+    for (const LedgerEntry &entry : s_ledger)
+    {
+        snprintf(line, sizeof(line), "%-40s%4dx%-4d\t%s\t%d\t%ld\n", entry.name.c_str(), entry.width, entry.height,
+                 FORMAT_NAMES[entry.format], entry.level_count, entry.byte_count);
+        std::cout << line;
+    }
+
+    long total = get_total_bytes();
+    std::cout << "total " << total / BYTES_PER_MEGABYTE << " MB of a " << budget / BYTES_PER_MEGABYTE
+              << " MB budget" << (total > budget ? ", over budget\n" : "\n");
+}
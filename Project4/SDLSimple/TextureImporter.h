@@ -0,0 +1,63 @@
+#ifndef TEXTURE_IMPORTER_H
+#define TEXTURE_IMPORTER_H
+
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+#include "ShaderProgram.h"
+
+enum TextureFormat { TEXTURE_RGBA, TEXTURE_RGB, TEXTURE_GREY };
+
+// How an image file becomes a texture
+struct TextureImportSettings
+{
+    TextureFormat format           = TEXTURE_RGBA; // RGB for opaque images, GREY for single-channel ones
+    bool          generate_mipmaps = false;        // for textures drawn smaller than they are
+    glm::ivec2    max_size         = glm::ivec2(0); // the size it is drawn at; 0 keeps the file's size
+};
+
+/**
+ * Loads images into textures with per-asset settings, and keeps a ledger of every
+ * texture the game has made and what it costs, so they can be listed against a
+ * budget. Textures made elsewhere are added to the ledger with record().
+ *
+ * Costs are what each format asks for, mipmaps included; some drivers store RGB
+ * with a padding byte, so on those an RGB texture costs as much as RGBA.
+ */
+class TextureImporter
+{
+private:
+    struct LedgerEntry
+    {
+        std::string   name;
+        GLuint        texture_id;
+        int           width, height, level_count;
+        TextureFormat format;
+        long          byte_count;
+    };
+
+    static std::vector<LedgerEntry> s_ledger;
+
+public:
+    // ————— METHODS ————— //
+    // Loads filepath with settings; a missing file is an error, as with every asset
+    static GLuint load(const char *filepath, const TextureImportSettings &settings = TextureImportSettings());
+
+    // Shrinks a width x height image of channels bytes a pixel to at most max_size in
+    // each direction by averaging the pixels each new one covers. Returns false,
+    // leaving the image alone, if it already fits.
+    static bool downscale(std::vector<unsigned char> &pixels, int &width, int &height, int channels,
+                          glm::ivec2 max_size);
+
+    static void record(const char *name, GLuint texture_id, int width, int height, TextureFormat format,
+                       bool has_mipmaps);
+    static void forget(GLuint texture_id);
+
+    // Lists every texture in the ledger with its cost, and the total against budget
+    static void report(long budget);
+
+    static int  const get_channel_count(TextureFormat format);
+    static long const get_total_bytes();
+};
+
+#endif // TEXTURE_IMPORTER_H
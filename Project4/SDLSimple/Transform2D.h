@@ -0,0 +1,89 @@
+#ifndef TRANSFORM_2D_H
+#define TRANSFORM_2D_H
+
+#include <cmath>
+#include "glm/glm.hpp"
+
+/**
+ * Where a flat sprite's quad ends up: a 2D affine map (a 3x2 matrix) for x and y,
+ *
+ *     x' = a x + c y + tx
+ *     y' = b x + d y + ty
+ *
+ * plus the depth a point is turned to, z' = zx x + zy y, which is only non-zero
+ * for sprites rotated out of the screen plane. It holds the same values as the
+ * first, second and last columns of translate * rotate * scale, bit for bit,
+ * without ever building the 4x4 matrices.
+ */
+struct Transform2D
+{
+    float a  = 1.0f, b  = 0.0f,
+          c  = 0.0f, d  = 1.0f,
+          tx = 0.0f, ty = 0.0f,
+          zx = 0.0f, zy = 0.0f;
+
+    // The rotation and scale part; the translation is left as it is
+    void set_linear(float angle, glm::vec3 axis, glm::vec2 scale)
+    {
+        if (angle == 0.0f)
+        {
+            a = scale.x; b = 0.0f;
+            c = 0.0f;    d = scale.y;
+            zx = zy = 0.0f;
+            return;
+        }
+
+        float cosine = cosf(angle),
+              sine   = sinf(angle);
+
+        // The usual case for a 2D game, a turn in the screen plane
+        if (axis.x == 0.0f && axis.y == 0.0f)
+        {
+            if (axis.z < 0.0f) sine = -sine;
+            a =  cosine * scale.x; b = sine   * scale.x;
+            c = -sine   * scale.y; d = cosine * scale.y;
+            zx = zy = 0.0f;
+            return;
+        }
+
+        // Anything else, the level's flipped platforms among them, takes the first
+        // two columns of glm::rotate's matrix, worked out the same way
+        glm::vec3 n = glm::normalize(axis),
+                  t = (1.0f - cosine) * n;
+        a  = (cosine + t.x * n.x)     * scale.x;
+        b  = (t.x * n.y + sine * n.z) * scale.x;
+        zx = (t.x * n.z - sine * n.y) * scale.x;
+        c  = (t.y * n.x - sine * n.z) * scale.y;
+        d  = (cosine + t.y * n.y)     * scale.y;
+        zy = (t.y * n.z + sine * n.x) * scale.y;
+    }
+
+    void set_translation(glm::vec2 translation) { tx = translation.x; ty = translation.y; }
+
+    glm::vec3 apply(glm::vec2 point) const
+    {
+        return glm::vec3(a * point.x + c * point.y + tx,
+                         b * point.x + d * point.y + ty,
+                         zx * point.x + zy * point.y);
+    }
+
+    static Transform2D make(glm::vec2 translation, float angle, glm::vec3 axis, glm::vec2 scale)
+    {
+        Transform2D transform;
+        transform.set_linear(angle, axis, scale);
+        transform.set_translation(translation);
+        return transform;
+    }
+
+    // alpha of the way from one to the other. Only the translation is blended; the
+    // rest is taken from to, as nothing in the game turns or grows between steps.
+    static Transform2D interpolate(const Transform2D &from, const Transform2D &to, float alpha)
+    {
+        Transform2D transform = to;
+        transform.tx = from.tx + (to.tx - from.tx) * alpha;
+        transform.ty = from.ty + (to.ty - from.ty) * alpha;
+        return transform;
+    }
+};
+
+#endif // TRANSFORM_2D_H
@@ -0,0 +1,49 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+/**
+ * Hands values from one writer thread to one reader thread without either ever
+ * waiting. The writer fills its slot and publishes it; the reader takes the most
+ * recently published slot. A third slot sits between them, so each side always
+ * owns one slot outright. Values the reader never got to are simply overwritten.
+ */
+template <typename T>
+class TripleBuffer
+{
+private:
+    static constexpr int INDEX_MASK = 3,
+                         FRESH_BIT  = 4; // set when the middle slot holds a value not yet read
+
+    T m_slots[3];
+
+    int              m_write  = 0,
+                     m_read   = 1;
+    std::atomic<int> m_middle { 2 };
+
+public:
+    // ————— SET-UP ————— //
+    // Calls function on each of the three slots; only safe before either side starts
+    template <typename Function>
+    void for_each_slot(Function function) { for (T &slot : m_slots) function(slot); }
+
+    // ————— WRITER ————— //
+    T &get_write_slot() { return m_slots[m_write]; }
+
+    // Makes the write slot the newest value, and hands the writer the older middle slot
+    void publish() { m_write = m_middle.exchange(m_write | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK; }
+
+    // ————— READER ————— //
+    // Takes the newest published value, if there is one the reader has not seen yet
+    bool acquire()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) return false;
+        m_read = m_middle.exchange(m_read, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T &get_read_slot() const { return m_slots[m_read]; }
+};
+
+#endif // TRIPLE_BUFFER_H
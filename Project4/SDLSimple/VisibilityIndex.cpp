@@ -0,0 +1,26 @@
+#include "VisibilityIndex.h"
+
+void VisibilityIndex::add(const AABB &bounds)
+{
+    m_bounds.push_back(bounds);
+    m_count++;
+}
+
+void VisibilityIndex::build()
+{
+    m_bvh.build(m_bounds);
+    std::vector<AABB>().swap(m_bounds);
+}
+
+void VisibilityIndex::query(const AABB &view, std::vector<Range> &out)
+{
+    out.clear();
+
+    // The hierarchy hands its results back sorted, so merging is one pass
+    m_bvh.query(view, m_hits);
+    for (int index : m_hits)
+    {
+        if (!out.empty() && out.back().first + out.back().count == index) out.back().count++;
+        else out.push_back({ index, 1 });
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef VISIBILITY_INDEX_H
+#define VISIBILITY_INDEX_H
+
+#include <vector>
+#include "StaticBVH.h"
+
+/**
+ * The drawn bounds of a fixed list of sprites, kept in a StaticBVH so the ones a
+ * view can see are found without testing every sprite. Queries come back as
+ * ranges of consecutive sprites, which is how batched geometry gets drawn.
+ */
+class VisibilityIndex
+{
+public:
+    struct Range
+    {
+        int first, count;
+    };
+
+private:
+    std::vector<AABB> m_bounds; // only kept until build()
+    StaticBVH         m_bvh;
+    std::vector<int>  m_hits;   // reused by every query
+    int               m_count = 0;
+
+public:
+    // ————— METHODS ————— //
+    // Sprites are numbered in the order they are added
+    void add(const AABB &bounds);
+
+    // Builds the hierarchy and frees the bounds; call once after the last add()
+    void build();
+
+    // Replaces out with the sprites whose bounds overlap view, as ascending ranges
+    // with neighbouring sprites merged
+    void query(const AABB &view, std::vector<Range> &out);
+
+    // ————— GETTERS ————— //
+    int const get_count() const { return m_count; }
+};
+
+#endif // VISIBILITY_INDEX_H
@@ -27,10 +27,30 @@
 #include "ShaderProgram.h"
 #include "stb_image.h"
 #include "cmath"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <ctime>
+#include <thread>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
 #include "Entity.h"
+#include "PhysicsWorld.h"
+#include "SpriteBatch.h"
+#include "SpriteInstances.h"
+#include "StaticMesh.h"
+#include "TextCache.h"
+#include "RenderQueue.h"
+#include "TextureAtlas.h"
+#include "Camera.h"
+#include "VisibilityIndex.h"
+#include "TripleBuffer.h"
+#include "HeadlessContext.h"
+#include "GpuProfiler.h"
+#include "CachedLayer.h"
+#include "TextureImporter.h"
+#include "Benchmark.h"
 
 // ––––– STRUCTS AND ENUMS ––––– //
 
@@ -46,6 +66,8 @@ struct GameState
     Entity* enemies;
     Entity* target;
     Entity* jumpscare;
+    PhysicsWorld* world;
+    JobSystem* jobs;
 };
 
 // ––––– CONSTANTS ––––– //
@@ -59,6 +81,12 @@ constexpr int WINDOW_WIDTH  = 640 * 2,
 constexpr float LEFT_BORDER = -4.55;
 constexpr float RIGHT_BORDER = 4.55;
 
+// What the camera may show. This level fits on one screen, so the camera stays put;
+// the floor running off to the left is never seen, and is culled.
+constexpr AABB LEVEL_BOUNDS = { -5.0f, -3.75f, 5.0f, 3.75f };
+constexpr float CAMERA_HALF_WIDTH  = 5.0f,
+                CAMERA_HALF_HEIGHT = 3.75f;
+
 constexpr float BG_RED     = 0.1922f,
             BG_BLUE    = 0.549f,
             BG_GREEN   = 0.9059f,
@@ -69,8 +97,15 @@ constexpr int VIEWPORT_X = 0,
           VIEWPORT_WIDTH  = WINDOW_WIDTH,
           VIEWPORT_HEIGHT = WINDOW_HEIGHT;
 
+// How many pixels one world unit covers on screen
+constexpr float PIXELS_PER_UNIT_X = VIEWPORT_WIDTH  / (2.0f * CAMERA_HALF_WIDTH),
+                PIXELS_PER_UNIT_Y = VIEWPORT_HEIGHT / (2.0f * CAMERA_HALF_HEIGHT);
+
 constexpr char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
-           F_SHADER_PATH[] = "shaders/fragment_textured.glsl";
+           F_SHADER_PATH[] = "shaders/fragment_textured.glsl",
+           V_INSTANCED_SHADER_PATH[] = "shaders/vertex_textured_instanced.glsl";
+
+constexpr char GPU_PROFILE_LOG_PATH[] = "gpu_profile.log";
 
 constexpr float MILLISECONDS_IN_SECOND = 1000.0;
 constexpr char SPRITESHEET_FILEPATH[] = "assets/rat.png";
@@ -82,10 +117,11 @@ constexpr char MONSTER_2_FILEPATH[] = "assets/horror_character_2.png";
 constexpr char FONT_FILEPATH[] = "assets/font1.png";
 constexpr char TARGET_FILEPATH[] = "assets/target.png";
 constexpr char JUMP_SCARE_FILEPATH[] = "assets/jump_scare.png";
- 
-constexpr int NUMBER_OF_TEXTURES = 1;
-constexpr GLint LEVEL_OF_DETAIL  = 0;
-constexpr GLint TEXTURE_BORDER   = 0;
+
+constexpr float TARGET_SIZE = 0.8f;
+
+// What every texture together should stay under
+constexpr long VRAM_BUDGET = 64L * 1024 * 1024;
 
 constexpr int CD_QUAL_FREQ    = 44100,
           AUDIO_CHAN_AMT  = 2,     // stereo
@@ -111,61 +147,212 @@ constexpr glm::vec3 SUBMARINE_INITSCALE = glm::vec3(1.37f, 1.0f, 0.0f);
 // ––––– GLOBAL VARIABLES ––––– //
 GameState g_state;
 
-AppStatus g_app_status = RUNNING;
+// Set by input on the main thread, and read by the simulation thread to know when to stop
+std::atomic<AppStatus> g_app_status { RUNNING };
+
+// SDL only delivers events on the main thread, so input is read there and handed to the
+// simulation thread. A jump is a key press, so it stays set until a step has seen it.
+std::atomic<bool> g_is_left_held  { false },
+                  g_is_right_held { false },
+                  g_is_down_held  { false },
+                  g_is_jump_pressed { false };
 
 SDL_Window* g_display_window;
+SDL_GLContext g_gl_context;
 
 bool ifGameEnd = false;
 bool ifWin = false;
 bool ifScreamed = false;
 
 ShaderProgram g_shader_program;
+SpriteBatch* g_sprite_batch;
+
+// Everything drawn in a frame is submitted here and sorted; layers keep the painter's
+// order, and within a layer the queue is free to group by texture
+enum RenderLayer : uint8_t
+{
+    RENDER_BACKGROUND, RENDER_PLAYER, RENDER_PLATFORMS, RENDER_ENEMIES, RENDER_END_TEXT, RENDER_TARGET,
+    RENDER_HINT_TEXT, RENDER_JUMPSCARE, RENDER_PROFILER
+};
+constexpr const char* RENDER_LAYER_NAMES[] = { "background", "player", "platforms", "enemies", "end text", "target",
+                                               "hint text", "jumpscare", "profiler" };
+RenderQueue g_render_queue;
+
+// --profile-gpu times every layer on the GPU, shows the times over the game, averaged
+// over GpuProfiler::AVERAGE_FRAMES frames, and writes each frame's to GPU_PROFILE_LOG_PATH
+bool g_profile_gpu = false;
+GpuProfiler* g_gpu_profiler = NULL;
+
+// The platforms never move, so by default they are baked into one static mesh.
+// --platforms instanced draws them with instanced arrays where the context has them,
+// and --platforms batched sends them through the sprite batch like everything else.
+enum PlatformMode { PLATFORMS_BATCHED, PLATFORMS_INSTANCED, PLATFORMS_BAKED };
+PlatformMode g_platform_mode = PLATFORMS_BAKED;
+
+ShaderProgram g_instanced_program;
+SpriteInstances* g_platform_instances = NULL;
+StaticMesh* g_platform_mesh = NULL;
 glm::mat4 g_view_matrix, g_projection_matrix;
 
+// Follows the player; anything outside its view is culled
+Camera g_camera(CAMERA_HALF_WIDTH, CAMERA_HALF_HEIGHT);
+
+// In --platforms batched mode, the platforms' drawn bounds, so that only the
+// visible ones are submitted
+VisibilityIndex g_platform_visibility;
+std::vector<VisibilityIndex::Range> g_visible_platforms;
+
 float g_previous_ticks = 0.0f;
 float g_accumulator = 0.0f;
-int jump_scare_counter = 0;
 
-GLuint g_font_texture_id;
+// Seconds since the game was lost, counted in fixed steps
+constexpr float SCREAM_DELAY     = 290.0f / 60.0f,
+                JUMP_SCARE_DELAY = 300.0f / 60.0f;
+float g_jump_scare_time = 0.0f;
+
+// ––––– SIMULATION THREAD ––––– //
+// The simulation runs on its own thread, and after every batch of fixed steps it
+// publishes what there is to draw. The main thread keeps the window and the GL
+// context, as SDL requires on macOS, and draws the newest snapshot it has, blending
+// each sprite between the last two steps.
+struct SnapshotSprite
+{
+    uint8_t     layer;
+    SpriteState state;    // as of the latest step
+    Transform2D previous; // as of the step before
+};
+
+struct FrameSnapshot
+{
+    std::vector<SnapshotSprite> sprites;
+    glm::vec2 focus, previous_focus; // where the camera looks; the player
+    float     step_time;             // when the latest step's state was current, in seconds
+    bool      is_game_over, has_won, show_jump_scare;
+};
+
+TripleBuffer<FrameSnapshot> g_snapshots;
+
+// The entities that move, with the layers they are drawn on, and their transforms
+// before the step being taken
+struct DynamicSprite
+{
+    Entity*     entity;
+    RenderLayer layer;
+};
+std::vector<DynamicSprite> g_dynamic_sprites;
+std::vector<Transform2D>   g_previous_transforms;
+
+// Things that never change, copied out once so drawing never reads an entity
+SpriteState g_background_sprite, g_jump_scare_sprite;
+std::vector<SpriteState> g_platform_sprites; // only in --platforms batched mode
+
+bool g_validate_bvh = false;
+
+// --physics-hz lowers the step rate; anything below 60 sweeps bodies so they cannot tunnel
+float g_fixed_timestep = FIXED_TIMESTEP;
+
+// --log-sleep prints the awake and sleeping body counts whenever they change
+bool g_log_sleep = false;
+int  g_awake_count = 0, g_sleeping_count = 0;
+
+// --log-vram lists every texture and its cost against VRAM_BUDGET once all are loaded
+bool g_log_vram = false;
+
+// What the last frame cost
+struct FrameStats
+{
+    int draw_calls, sprite_count, culled_count,
+        bytes_uploaded, // vertex data streamed to the GPU
+        shader_calls_issued, shader_calls_skipped;
+};
+FrameStats g_frame_stats = {};
+
+// --log-draws prints the draw calls, sprites drawn and culled per frame, the shader calls
+// the ShaderProgram caches let through and held back, and the vertex bytes streamed,
+// whenever they change
+bool g_log_draws = false;
+FrameStats g_logged_stats = {};
+
+// --bench-render N draws N frames offscreen, with no window, and reports what they
+// cost; --hash-frames adds a hash of every frame drawn, to check the output as well
+HeadlessContext g_headless_context;
+bool g_is_headless  = false,
+     g_hash_frames  = false;
+int  g_bench_frames = 0;
+
+// The background only changes with the camera, so where the context has framebuffer
+// objects it is drawn offscreen once and copied to the screen each frame;
+// --no-layer-cache draws it every frame. The platforms stay out of the copy, because
+// they are drawn over the player.
+CachedLayer* g_background_layer = NULL;
+bool g_use_layer_cache = true;
+
+// Every small sprite image shares one or two atlas pages; --no-atlas gives each its own texture
+TextureAtlas* g_texture_atlas;
+bool g_use_atlas = true;
+AtlasRegion g_font_region;
+TextCache g_text_cache;
 // ––––– GENERAL FUNCTIONS ––––– //
-GLuint load_texture(const char* filepath)
+// The most pixels a sprite drawn at scale ever covers, so the most its texture needs
+glm::ivec2 get_drawn_size(glm::vec2 scale)
 {
-    int width, height, number_of_components;
-    unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
+    return glm::ivec2(glm::ceil(scale * glm::vec2(PIXELS_PER_UNIT_X, PIXELS_PER_UNIT_Y)));
+}
 
-    if (image == NULL)
-    {
-        LOG("Unable to load image. Make sure the path is correct.");
-        assert(false);
-    }
+void record_previous_transforms()
+{
+    g_previous_transforms.resize(g_dynamic_sprites.size());
+    for (size_t i = 0; i < g_dynamic_sprites.size(); i++)
+        g_previous_transforms[i] = g_dynamic_sprites[i].entity->get_transform();
+}
 
-    GLuint textureID;
-    glGenTextures(NUMBER_OF_TEXTURES, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image);
+// Hands the main thread the state after the latest step, which was current at step_time
+void publish_snapshot(float step_time)
+{
+    FrameSnapshot &snapshot = g_snapshots.get_write_slot();
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    snapshot.sprites.clear();
+    for (size_t i = 0; i < g_dynamic_sprites.size(); i++)
+    {
+        SnapshotSprite sprite;
+        if (!g_dynamic_sprites[i].entity->get_sprite_state(sprite.state)) continue;
 
+        sprite.layer    = g_dynamic_sprites[i].layer;
+        sprite.previous = g_previous_transforms[i];
+        snapshot.sprites.push_back(sprite);
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // The player is always the first dynamic sprite
+    snapshot.focus          = glm::vec2(g_state.player->get_position());
+    snapshot.previous_focus = glm::vec2(g_previous_transforms[0].tx, g_previous_transforms[0].ty);
 
-    stbi_image_free(image);
+    snapshot.step_time       = step_time;
+    snapshot.is_game_over    = ifGameEnd;
+    snapshot.has_won         = ifWin;
+    snapshot.show_jump_scare = g_jump_scare_time >= JUMP_SCARE_DELAY;
 
-    return textureID;
+    g_snapshots.publish();
 }
 
 void initialise()
 {
-    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
-    g_display_window = SDL_CreateWindow("Hello, Physics (again)!",
-                                      SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                      WINDOW_WIDTH, WINDOW_HEIGHT,
-                                      SDL_WINDOW_OPENGL);
-
-    SDL_GLContext context = SDL_GL_CreateContext(g_display_window);
-    SDL_GL_MakeCurrent(g_display_window, context);
+    // Headless, there is no display for a window, nor a device to play sound on
+    if (g_is_headless)
+    {
+        SDL_Init(0);
+        if (!g_headless_context.create(WINDOW_WIDTH, WINDOW_HEIGHT)) exit(1);
+    }
+    else
+    {
+        SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
+        g_display_window = SDL_CreateWindow("Hello, Physics (again)!",
+                                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          WINDOW_WIDTH, WINDOW_HEIGHT,
+                                          SDL_WINDOW_OPENGL);
+
+        g_gl_context = SDL_GL_CreateContext(g_display_window);
+        SDL_GL_MakeCurrent(g_display_window, g_gl_context);
+    }
 
 #ifdef _WINDOWS
     glewInit();
@@ -176,18 +363,21 @@ void initialise()
 
     g_shader_program.load(V_SHADER_PATH, F_SHADER_PATH);
 
-    g_view_matrix = glm::mat4(1.0f);
-    g_projection_matrix = glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f);
+    g_camera.set_limits(LEVEL_BOUNDS);
+    g_view_matrix = g_camera.get_view_matrix();
+    g_projection_matrix = g_camera.get_projection_matrix();
 
     g_shader_program.set_projection_matrix(g_projection_matrix);
     g_shader_program.set_view_matrix(g_view_matrix);
 
-    glUseProgram(g_shader_program.get_program_id());
+    g_shader_program.use();
+
+    g_sprite_batch = new SpriteBatch(&g_shader_program);
 
     glClearColor(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
 
     // ––––– BGM ––––– //
-    Mix_OpenAudio(CD_QUAL_FREQ, MIX_DEFAULT_FORMAT, AUDIO_CHAN_AMT, AUDIO_BUFF_SIZE);
+    if (!g_is_headless) Mix_OpenAudio(CD_QUAL_FREQ, MIX_DEFAULT_FORMAT, AUDIO_CHAN_AMT, AUDIO_BUFF_SIZE);
 
     // STEP 1: Have openGL generate a pointer to your music file
     g_music = Mix_LoadMUS(BGM_FILEPATH); // works only with mp3 files
@@ -205,16 +395,35 @@ void initialise()
     // ––––– SFX ––––– //
     g_jump_sfx = Mix_LoadWAV(SFX_FILEPATH);
 
-    // ––––– PLATFORMS ––––– //
-    GLuint platform_texture_id = load_texture(PLATFORM_FILEPATH);
-    GLuint second_platform_texture_id = load_texture(SECOND_PLATFORM_FILEPATH);
-    GLuint background_texture_id = load_texture(BACKGROUND_FILEPATH);
-    g_font_texture_id = load_texture(FONT_FILEPATH);
+    // ––––– PHYSICS ––––– //
+    // Every entity created from here on gets its body from this world
+    g_state.jobs  = new JobSystem();
+    g_state.world = new PhysicsWorld();
+    g_state.world->make_current();
+    g_state.world->set_continuous(g_fixed_timestep > FIXED_TIMESTEP);
+
+    // ––––– TEXTURES ––––– //
+    // The full-screen images keep textures of their own
+    g_texture_atlas = new TextureAtlas(g_use_atlas);
+    int platform_image        = g_texture_atlas->add(PLATFORM_FILEPATH),
+        second_platform_image = g_texture_atlas->add(SECOND_PLATFORM_FILEPATH),
+        font_image            = g_texture_atlas->add(FONT_FILEPATH),
+        player_image          = g_texture_atlas->add(SPRITESHEET_FILEPATH),
+        enemy_image           = g_texture_atlas->add(MONSTER_FILEPATH),
+        enemy_2_image         = g_texture_atlas->add(MONSTER_2_FILEPATH),
+        target_image          = g_texture_atlas->add(TARGET_FILEPATH, get_drawn_size(glm::vec2(TARGET_SIZE)));
+    g_texture_atlas->build();
+
+    g_font_region = g_texture_atlas->get_region(font_image);
 
+    // ––––– PLATFORMS ––––– //
+    AtlasRegion platform_region = g_texture_atlas->get_region(platform_image);
+    AtlasRegion second_platform_region = g_texture_atlas->get_region(second_platform_image);
+    // The full-screen images are opaque JPEGs, so they have no alpha channel
     g_state.background = new Entity();
-    g_state.background->set_texture_id(background_texture_id);
     g_state.background->set_scale(glm::vec3(13.26, 7.6, 0.0f));
-    g_state.background->update(0.0f, NULL, NULL, 0);
+    g_state.background->set_texture_id(TextureImporter::load(BACKGROUND_FILEPATH,
+        { TEXTURE_RGB, false, get_drawn_size(g_state.background->get_scale()) }));
     
     g_state.base_platforms = new Entity[PLATFORM_COUNT];
     
@@ -223,15 +432,14 @@ void initialise()
     for (int i = 0; i < PLATFORM_COUNT; i++)
     {
         if(i <= 23){
-            g_state.base_platforms[i].set_texture_id(platform_texture_id);
+            g_state.base_platforms[i].set_texture_region(platform_region);
             g_state.base_platforms[i].set_position(glm::vec3(((i - PLATFORM_COUNT / 1.8f)+7.0f), -3.5f, 0.0f));
             g_state.base_platforms[i].set_width(1.35f);
             g_state.base_platforms[i].set_height(1.35f);
             g_state.base_platforms[i].set_scale(glm::vec3(1.0f, 1.0f, 0.0f));
             g_state.base_platforms[i].set_entity_type(PLATFORM);
-            g_state.base_platforms[i].update(0.0f, NULL, NULL, 0);
         } else if(i <= 29){
-            g_state.base_platforms[i].set_texture_id(second_platform_texture_id);
+            g_state.base_platforms[i].set_texture_region(second_platform_region);
             g_state.base_platforms[i].set_position(glm::vec3(((i-24 - 10 / 1.5f)+1.3), -1.15f, 0.0f));
             g_state.base_platforms[i].set_width(2.7f);
             g_state.base_platforms[i].set_height(0.35f);
@@ -240,64 +448,96 @@ void initialise()
             if(!flip_counter){
                 g_state.base_platforms[i].set_rotate_angle(180);
             }
-            g_state.base_platforms[i].update(0.0f, NULL, NULL, 0);
             flip_counter = !flip_counter;
         } else if(i < 31){
-            g_state.base_platforms[i].set_texture_id(second_platform_texture_id);
+            g_state.base_platforms[i].set_texture_region(second_platform_region);
             g_state.base_platforms[i].set_position(glm::vec3(-((0 - 23 / 1.5f)+11.7), -2.05f, 0.0f));
             g_state.base_platforms[i].set_width(3.1f);
             g_state.base_platforms[i].set_height(0.35f);
             g_state.base_platforms[i].set_scale(glm::vec3(3.16f, 0.5f, 0.0f));
             g_state.base_platforms[i].set_entity_type(PLATFORM);
-            g_state.base_platforms[i].update(0.0f, NULL, NULL, 0);
         } else if(i < 41){
-            g_state.base_platforms[i].set_texture_id(second_platform_texture_id);
+            g_state.base_platforms[i].set_texture_region(second_platform_region);
             g_state.base_platforms[i].set_position(glm::vec3(-((i-31 - 10 / 1.5f)-1.5f), -0.1f, 0.0f));
             g_state.base_platforms[i].set_width(2.5f);
             g_state.base_platforms[i].set_height(0.36f);
             g_state.base_platforms[i].set_scale(glm::vec3(3.16f, 0.5f, 0.0f));
             g_state.base_platforms[i].set_entity_type(PLATFORM);
-            g_state.base_platforms[i].update(0.0f, NULL, NULL, 0);
         } else if(i < 42){
-            g_state.base_platforms[i].set_texture_id(second_platform_texture_id);
+            g_state.base_platforms[i].set_texture_region(second_platform_region);
             g_state.base_platforms[i].set_position(glm::vec3(-((i-31 - 10 / 1.5f) + 1.7f), -0.5f, 0.0f));
             g_state.base_platforms[i].set_width(2.6f);
             g_state.base_platforms[i].set_height(0.36f);
             g_state.base_platforms[i].set_scale(glm::vec3(3.16f, 0.5f, 0.0f));
             g_state.base_platforms[i].set_entity_type(PLATFORM);
-            g_state.base_platforms[i].update(0.0f, NULL, NULL, 0);
         } else if(i < 43){
-            g_state.base_platforms[i].set_texture_id(second_platform_texture_id);
+            g_state.base_platforms[i].set_texture_region(second_platform_region);
             g_state.base_platforms[i].set_position(glm::vec3(-((i-31 - 10 / 1.5f) - 9.0f), 1.2f, 0.0f));
             g_state.base_platforms[i].set_width(1.2f);
             g_state.base_platforms[i].set_height(0.09f);
             g_state.base_platforms[i].set_scale(glm::vec3(1.58f, 0.25f, 0.0f));
             g_state.base_platforms[i].set_entity_type(PLATFORM);
-            g_state.base_platforms[i].update(0.0f, NULL, NULL, 0);
         } else if(i < 44){
-            g_state.base_platforms[i].set_texture_id(second_platform_texture_id);
+            g_state.base_platforms[i].set_texture_region(second_platform_region);
             g_state.base_platforms[i].set_position(glm::vec3(-((i-31 - 10 / 1.5f) - 8.8f), 0.9f, 0.0f));
             g_state.base_platforms[i].set_width(1.2f);
             g_state.base_platforms[i].set_height(0.09f);
             g_state.base_platforms[i].set_scale(glm::vec3(1.30f, 0.25f, 0.0f));
             g_state.base_platforms[i].set_entity_type(PLATFORM);
-            g_state.base_platforms[i].update(0.0f, NULL, NULL, 0);
         } else{
-            g_state.base_platforms[i].set_texture_id(second_platform_texture_id);
+            g_state.base_platforms[i].set_texture_region(second_platform_region);
             g_state.base_platforms[i].set_position(glm::vec3(-((i-31 - 10 / 1.5f) - 8.6f), 0.6f, 0.0f));
             g_state.base_platforms[i].set_width(1.2f);
             g_state.base_platforms[i].set_height(0.09f);
             g_state.base_platforms[i].set_scale(glm::vec3(1.30f, 0.25f, 0.0f));
             g_state.base_platforms[i].set_entity_type(PLATFORM);
-            g_state.base_platforms[i].update(0.0f, NULL, NULL, 0);
         }
     }
 
-    
+
+    // Platforms never move after this point, so the hierarchy is built once
+    g_state.world->build_static_broadphase();
+    g_state.world->get_static_bvh()->set_validate(g_validate_bvh);
+
+    // ...and so is their geometry
+    if (g_platform_mode == PLATFORMS_BAKED)
+    {
+        g_platform_mesh = new StaticMesh(&g_shader_program);
+        for (int i = 0; i < PLATFORM_COUNT; i++)
+        {
+            g_platform_mesh->add(g_state.base_platforms[i].get_texture_id(),
+                                 g_state.base_platforms[i].get_transform(),
+                                 g_state.base_platforms[i].get_uv_offset(),
+                                 g_state.base_platforms[i].get_uv_size());
+        }
+        g_platform_mesh->bake();
+    }
+    else if (g_platform_mode == PLATFORMS_INSTANCED && SpriteInstances::is_supported())
+    {
+        g_instanced_program.load(V_INSTANCED_SHADER_PATH, F_SHADER_PATH);
+        g_instanced_program.set_projection_matrix(g_projection_matrix);
+        g_instanced_program.set_view_matrix(g_view_matrix);
+
+        g_platform_instances = new SpriteInstances(&g_instanced_program);
+        for (int i = 0; i < PLATFORM_COUNT; i++)
+        {
+            g_platform_instances->add(g_state.base_platforms[i].get_texture_id(),
+                                      g_state.base_platforms[i].get_transform(),
+                                      g_state.base_platforms[i].get_uv_offset(),
+                                      g_state.base_platforms[i].get_uv_size());
+        }
+        g_platform_instances->upload();
+    }
+    else
+    {
+        for (int i = 0; i < PLATFORM_COUNT; i++)
+            g_platform_visibility.add(SpriteBatch::get_quad_bounds(g_state.base_platforms[i].get_transform()));
+        g_platform_visibility.build();
+    }
 
 
     // ––––– PLAYER (GEORGE) ––––– //
-    GLuint player_texture_id = load_texture(SPRITESHEET_FILEPATH);
+    AtlasRegion player_region = g_texture_atlas->get_region(player_image);
 
     int player_walking_animation[4][3] =
     {
@@ -310,7 +550,7 @@ void initialise()
     glm::vec3 acceleration = glm::vec3(0.0f, -9.8f, 0.0f);
 
     g_state.player = new Entity(
-        player_texture_id,         // texture id
+        player_region.texture_id,  // texture id
         3.0f,                      // speed
         acceleration,              // acceleration
         4.0f,                      // jumping power
@@ -325,6 +565,7 @@ void initialise()
         PLAYER
     );
 
+    g_state.player->set_texture_region(player_region);
     //g_state.player->set_position(glm::vec3(0.0f, 0.0f, 0.0f));
     g_state.player->set_scale(glm::vec3(0.8f, 0.8f, 0.8f));
     g_state.player->set_position(glm::vec3(-4.0f, -2.0f, 0.0f));
@@ -332,18 +573,21 @@ void initialise()
     g_state.player->set_jumping_power(4.5f);
     
     // AI Enemies
-    GLuint enemy_texture_id = load_texture(MONSTER_FILEPATH);
-    GLuint enemy_2_texture_id = load_texture(MONSTER_2_FILEPATH);
+    AtlasRegion enemy_region = g_texture_atlas->get_region(enemy_image);
+    AtlasRegion enemy_2_region = g_texture_atlas->get_region(enemy_2_image);
     g_state.enemies = new Entity[ENEMY_COUNT];
     
     for (int i = 0; i < ENEMY_COUNT; i++)
     {
         if(i == 0){
-            g_state.enemies[i] =  Entity(enemy_texture_id, 1.0f, 0.7f, 0.7f, ENEMY, GUARD, IDLE);
+            g_state.enemies[i] =  Entity(enemy_region.texture_id, 1.0f, 0.7f, 0.7f, ENEMY, GUARD, IDLE);
+            g_state.enemies[i].set_texture_region(enemy_region);
         } else if(i == 1){
-            g_state.enemies[i] =  Entity(enemy_2_texture_id, -1.0f, 0.5f, 0.7f, ENEMY, PATROLLING, RIGHTMOVING);
+            g_state.enemies[i] =  Entity(enemy_2_region.texture_id, -1.0f, 0.5f, 0.7f, ENEMY, PATROLLING, RIGHTMOVING);
+            g_state.enemies[i].set_texture_region(enemy_2_region);
         } else {
-            g_state.enemies[i] =  Entity(enemy_texture_id, 1.0f, 0.7f, 0.9f, ENEMY, JUMPER, IDLE);
+            g_state.enemies[i] =  Entity(enemy_region.texture_id, 1.0f, 0.7f, 0.9f, ENEMY, JUMPER, IDLE);
+            g_state.enemies[i].set_texture_region(enemy_region);
         }
     }
     
@@ -364,28 +608,64 @@ void initialise()
     g_state.enemies[2].set_acceleration(glm::vec3(0.0f, -9.81f, 0.0f));
     g_state.enemies[2].set_entity_type(ENEMY);
 
-    GLuint target_texture_id = load_texture(TARGET_FILEPATH);
     g_state.target = new Entity();
-    g_state.target->set_texture_id(target_texture_id);
+    g_state.target->set_texture_region(g_texture_atlas->get_region(target_image));
     g_state.target->set_position(glm::vec3(4.5f, 1.57f, 0.0f));
-    g_state.target->set_scale(glm::vec3(0.8f, 0.8f, 0.0f));
-    g_state.target->update(0.0f, NULL, NULL, 0);
+    g_state.target->set_scale(glm::vec3(TARGET_SIZE, TARGET_SIZE, 0.0f));
     
-    GLuint jump_scare_texture_id = load_texture(JUMP_SCARE_FILEPATH);
     g_state.jumpscare = new Entity();
-    g_state.jumpscare->set_texture_id(jump_scare_texture_id);
     g_state.jumpscare->set_scale(glm::vec3(8.0, 8.0, 0.0f));
-    g_state.jumpscare->update(0.0f, NULL, NULL, 0);
+    g_state.jumpscare->set_texture_id(TextureImporter::load(JUMP_SCARE_FILEPATH,
+        { TEXTURE_RGB, false, get_drawn_size(g_state.jumpscare->get_scale()) }));
+
+    // ––––– SNAPSHOTS ––––– //
+    g_dynamic_sprites.push_back({ g_state.player, RENDER_PLAYER });
+    for (int i = 0; i < ENEMY_COUNT; i++) g_dynamic_sprites.push_back({ &g_state.enemies[i], RENDER_ENEMIES });
+    g_dynamic_sprites.push_back({ g_state.target, RENDER_TARGET });
+
+    // Every slot is sized once here, so publishing never allocates
+    g_snapshots.for_each_slot([](FrameSnapshot &snapshot) { snapshot.sprites.reserve(g_dynamic_sprites.size()); });
+
+    g_state.background->get_sprite_state(g_background_sprite);
+    g_state.jumpscare->get_sprite_state(g_jump_scare_sprite);
+    if (g_platform_mesh == NULL && g_platform_instances == NULL)
+    {
+        g_platform_sprites.resize(PLATFORM_COUNT);
+        for (int i = 0; i < PLATFORM_COUNT; i++) g_state.base_platforms[i].get_sprite_state(g_platform_sprites[i]);
+    }
+
+    record_previous_transforms();
+    publish_snapshot(0.0f);
     
+    if (g_use_layer_cache && CachedLayer::is_supported())
+        g_background_layer = new CachedLayer(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+
+    // ––––– GPU PROFILER ––––– //
+    if (g_profile_gpu)
+    {
+        g_gpu_profiler = new GpuProfiler();
+        for (int layer = RENDER_BACKGROUND; layer <= RENDER_PROFILER; layer++)
+            g_gpu_profiler->set_pass_name(layer, RENDER_LAYER_NAMES[layer]);
+
+        if (!g_gpu_profiler->init())
+        {
+            delete g_gpu_profiler;
+            g_gpu_profiler = NULL;
+        }
+        else if (!g_gpu_profiler->open_log(GPU_PROFILE_LOG_PATH))
+            std::cout << "GPU profiler: could not write " << GPU_PROFILE_LOG_PATH << '\n';
+    }
+
     // ––––– GENERAL ––––– //
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    if (g_log_vram) TextureImporter::report(VRAM_BUDGET);
 }
 
+// Reads input on the main thread; apply_input() acts on it on the simulation thread
 void process_input()
 {
-    g_state.player->set_movement(glm::vec3(0.0f));
-
     SDL_Event event;
     while (SDL_PollEvent(&event))
     {
@@ -405,14 +685,7 @@ void process_input()
 
                     case SDLK_SPACE:
                         // Jump
-                        if((g_state.player->get_isHide())){
-                            return;
-                        }
-                        if (g_state.player->get_collided_bottom())
-                        {
-                            g_state.player->jump();
-                            // Mix_PlayChannel(NEXT_CHNL, g_jump_sfx, 0);
-                        }
+                        g_is_jump_pressed = true;
                         break;
 
                     case SDLK_h:
@@ -431,23 +704,43 @@ void process_input()
                 break;
         }
     }
-    
-    g_state.player->set_un_hiding();
 
     const Uint8 *key_state = SDL_GetKeyboardState(NULL);
+    g_is_left_held  = key_state[SDL_SCANCODE_LEFT];
+    g_is_right_held = key_state[SDL_SCANCODE_RIGHT];
+    g_is_down_held  = key_state[SDL_SCANCODE_DOWN];
+}
+
+void apply_input()
+{
+    g_state.player->set_movement(glm::vec3(0.0f));
+
+    if (g_is_jump_pressed.exchange(false))
+    {
+        if((g_state.player->get_isHide())){
+            return;
+        }
+        if (g_state.player->get_collided_bottom())
+        {
+            g_state.player->jump();
+            // Mix_PlayChannel(NEXT_CHNL, g_jump_sfx, 0);
+        }
+    }
 
-    if (key_state[SDL_SCANCODE_LEFT])
+    g_state.player->set_un_hiding();
+
+    if (g_is_left_held)
     {
         if(!ifGameEnd){
             g_state.player->move_left();
         }
     }
-    else if (key_state[SDL_SCANCODE_RIGHT])
+    else if (g_is_right_held)
     {
         if(!ifGameEnd){
             g_state.player->move_right();
         }
-    }else if (key_state[SDL_SCANCODE_DOWN]){
+    }else if (g_is_down_held){
         if(!ifGameEnd){
             g_state.player->set_hiding();
         }
@@ -461,153 +754,278 @@ void process_input()
     }
 }
 
-void update()
+// One fixed step of the whole game
+void step()
 {
-    if(ifGameEnd && !ifWin){
-        ++jump_scare_counter;
-    }
-    if(ifGameEnd){
+    // What drawing blends from
+    record_previous_transforms();
+
+    // Once the game is over nothing moves, but the jump scare is still on a clock
+    if (ifGameEnd)
+    {
+        if (!ifWin) g_jump_scare_time += g_fixed_timestep;
+        if (g_jump_scare_time >= SCREAM_DELAY && !ifScreamed)
+        {
+            ifScreamed = true;
+            Mix_PlayChannel(NEXT_CHNL, g_jump_sfx, 0);
+        }
         return;
     }
+
+    // Enemies see the player as it was at the start of the step
+    PlayerSnapshot player_snapshot = g_state.player->get_snapshot();
+    g_state.player->update(g_fixed_timestep, NULL);
+
+    // Enemies that have gone or fallen asleep are skipped until something wakes them
+    g_state.world->wake_near(player_snapshot.position, Entity::AI_WAKE_RADIUS);
+    Entity::update_all(g_state.jobs, g_state.enemies, ENEMY_COUNT, g_fixed_timestep, &player_snapshot);
+
+    g_state.world->step(g_fixed_timestep);
+    if (g_log_sleep && (g_state.world->get_awake_count() != g_awake_count ||
+                        g_state.world->get_sleeping_count() != g_sleeping_count))
+    {
+        g_awake_count    = g_state.world->get_awake_count();
+        g_sleeping_count = g_state.world->get_sleeping_count();
+        LOG("awake " << g_awake_count << ", sleeping " << g_sleeping_count);
+    }
+    if(g_state.player->get_collided_enemy()){
+        ifGameEnd = true;
+    }
+    
+    if((g_state.player->get_position()).x >= 4.5f && (g_state.player->get_position()).y >= 1.57f){
+        ifGameEnd = true;
+        ifWin = true;
+    }
+}
+
+void update()
+{
     float ticks = (float)SDL_GetTicks() / MILLISECONDS_IN_SECOND;
     float delta_time = ticks - g_previous_ticks;
     g_previous_ticks = ticks;
 
     delta_time += g_accumulator;
 
-    if (delta_time < FIXED_TIMESTEP)
+    if (delta_time < g_fixed_timestep)
     {
         g_accumulator = delta_time;
         return;
     }
 
-    while (delta_time >= FIXED_TIMESTEP)
+    while (delta_time >= g_fixed_timestep)
     {
-        g_state.player->update(FIXED_TIMESTEP, NULL, g_state.base_platforms, g_state.enemies, PLATFORM_COUNT, ENEMY_COUNT);
-        for (int i = 0; i < ENEMY_COUNT; i++)
-            g_state.enemies[i].update(FIXED_TIMESTEP,
-                                      g_state.player,
-                                      g_state.base_platforms,
-                                                   PLATFORM_COUNT);
-        if(g_state.player->get_collided_enemy()){
-            ifGameEnd = true;
-        }
-        
-        if((g_state.player->get_position()).x >= 4.5f && (g_state.player->get_position()).y >= 1.57f){
-            ifGameEnd = true;
-            ifWin = true;
-        }
-        delta_time -= FIXED_TIMESTEP;
+        step();
+        delta_time -= g_fixed_timestep;
     }
 
     g_accumulator = delta_time;
+    publish_snapshot(ticks - g_accumulator);
 }
 
-constexpr int FONTBANK_SIZE = 16;
+// Text that never changes is laid out once and reused; dynamic text (a score, a
+// timer) is laid out again every call into a reused scratch mesh
+// A scratch mesh is reused by the next dynamic string in the same slot, so dynamic
+// strings in one frame must each have a slot of their own
+void draw_text(RenderQueue *queue, uint8_t layer, const AtlasRegion &font, const char *text,
+               float font_size, float spacing, glm::vec3 position, bool is_dynamic = false, int scratch_slot = 0)
+{
+    const std::vector<float> &mesh = is_dynamic ? g_text_cache.get_scratch_mesh(font, text, font_size, spacing, scratch_slot)
+                                                : g_text_cache.get_mesh(font, text, font_size, spacing);
+    queue->submit_mesh(layer, font.texture_id, mesh, position);
+}
 
-void draw_text(ShaderProgram *program, GLuint font_texture_id, std::string text,
-               float font_size, float spacing, glm::vec3 position)
+// Lists the GPU time of every layer in the top left corner, one dynamic string a line
+void draw_gpu_profile(glm::vec3 screen_origin)
 {
-    // Scale the size of the fontbank in the UV-plane
-    // We will use this for spacing and positioning
-    float width = 1.0f / FONTBANK_SIZE;
-    float height = 1.0f / FONTBANK_SIZE;
-
-    // Instead of having a single pair of arrays, we'll have a series of pairs—one for
-    // each character. Don't forget to include <vector>!
-    std::vector<float> vertices;
-    std::vector<float> texture_coordinates;
-
-    // For every character...
-    for (int i = 0; i < text.size(); i++) {
-        // 1. Get their index in the spritesheet, as well as their offset (i.e. their
-        //    position relative to the whole sentence)
-        int spritesheet_index = (int) text[i];  // ascii value of character
-        float offset = (font_size + spacing) * i;
-        
-        // 2. Using the spritesheet index, we can calculate our U- and V-coordinates
-        float u_coordinate = (float) (spritesheet_index % FONTBANK_SIZE) / FONTBANK_SIZE;
-        float v_coordinate = (float) (spritesheet_index / FONTBANK_SIZE) / FONTBANK_SIZE;
-
-        // 3. Inset the current pair in both vectors
-        vertices.insert(vertices.end(), {
-            offset + (-0.5f * font_size), 0.5f * font_size,
-            offset + (-0.5f * font_size), -0.5f * font_size,
-            offset + (0.5f * font_size), 0.5f * font_size,
-            offset + (0.5f * font_size), -0.5f * font_size,
-            offset + (0.5f * font_size), 0.5f * font_size,
-            offset + (-0.5f * font_size), -0.5f * font_size,
-        });
-
-        texture_coordinates.insert(texture_coordinates.end(), {
-            u_coordinate, v_coordinate,
-            u_coordinate, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate + width, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate, v_coordinate + height,
-        });
-    }
-
-    // 4. And render all of them using the pairs
-    glm::mat4 model_matrix = glm::mat4(1.0f);
-    model_matrix = glm::translate(model_matrix, position);
-    
-    program->set_model_matrix(model_matrix);
-    glUseProgram(program->get_program_id());
-    
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0,
-                          vertices.data());
-    glEnableVertexAttribArray(program->get_position_attribute());
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0,
-                          texture_coordinates.data());
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
-    
-    glBindTexture(GL_TEXTURE_2D, font_texture_id);
-    glDrawArrays(GL_TRIANGLES, 0, (int) (text.size() * 6));
-    
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    char line[TextCache::SCRATCH_GLYPHS];
+    glm::vec3 position = screen_origin + glm::vec3(-4.8f, 3.5f, 0.0f);
+
+    snprintf(line, sizeof(line), "gpu ms (%d dropped)", g_gpu_profiler->get_dropped_count());
+    draw_text(&g_render_queue, RENDER_PROFILER, g_font_region, line, 0.18f, 0.0f, position, true, 0);
+
+    for (int layer = RENDER_BACKGROUND; layer <= RENDER_PROFILER; layer++)
+    {
+        position.y -= 0.22f;
+        snprintf(line, sizeof(line), "%-10s %.3f", RENDER_LAYER_NAMES[layer], g_gpu_profiler->get_average_ms(layer));
+        draw_text(&g_render_queue, RENDER_PROFILER, g_font_region, line, 0.18f, 0.0f, position, true, layer + 1);
+    }
 }
 
-void render()
+void submit_background()
 {
-    glClear(GL_COLOR_BUFFER_BIT);
+    g_render_queue.submit_sprite(RENDER_BACKGROUND, g_background_sprite.texture_id, g_background_sprite.transform,
+                                 g_background_sprite.uv_offset, g_background_sprite.uv_size);
+}
 
-    g_state.background->render(&g_shader_program);
-    
-    g_state.player->render(&g_shader_program);
+void submit_platforms()
+{
+    if (g_platform_mesh != NULL) g_render_queue.submit_static_mesh(RENDER_PLATFORMS, g_platform_mesh);
+    else if (g_platform_instances != NULL) g_render_queue.submit_instances(RENDER_PLATFORMS, g_platform_instances);
+    else
+    {
+        g_platform_visibility.query(g_camera.get_visible_bounds(), g_visible_platforms);
+        for (const VisibilityIndex::Range &range : g_visible_platforms)
+            for (int i = range.first; i < range.first + range.count; ++i)
+                g_render_queue.submit_sprite(RENDER_PLATFORMS, g_platform_sprites[i].texture_id,
+                                             g_platform_sprites[i].transform, g_platform_sprites[i].uv_offset,
+                                             g_platform_sprites[i].uv_size);
+    }
+}
 
-    for (int i = 0; i < PLATFORM_COUNT; ++i) g_state.base_platforms[i].render(&g_shader_program);
-    for (int i = 0; i < ENEMY_COUNT; i++) g_state.enemies[i].render(&g_shader_program);
-    
-    if(ifGameEnd && !ifWin){
-        draw_text(&g_shader_program, g_font_texture_id, "**You Lose**", 0.5f, 0.05f,
-                      glm::vec3(-3.1f, 3.0f, 0.0f));
+// Draws snapshot, alpha of the way from its previous step to its latest, and fills in
+// g_frame_stats; presenting the frame is left to the caller
+void draw_frame(const FrameSnapshot &snapshot, float alpha)
+{
+    if (g_gpu_profiler != NULL) g_gpu_profiler->begin_frame();
+
+    // The camera moves before anything is submitted, so culling and drawing agree
+    g_camera.follow(glm::mix(snapshot.previous_focus, snapshot.focus, alpha));
+    g_view_matrix = g_camera.get_view_matrix();
+    g_shader_program.set_view_matrix(g_view_matrix);
+    if (g_platform_instances != NULL) g_instanced_program.set_view_matrix(g_view_matrix);
+    g_render_queue.set_view(g_camera.get_visible_bounds());
+
+    // The background, text and jump scare stay where they are on screen
+    glm::vec3 screen_origin = glm::vec3(g_camera.get_position(), 0.0f);
+    g_background_sprite.transform.set_translation(g_camera.get_position());
+    g_jump_scare_sprite.transform.set_translation(g_camera.get_position());
+
+    ShaderProgram::reset_counters();
+    g_render_queue.reset_counters();
+    g_sprite_batch->reset_counters();
+    if (g_platform_mesh != NULL)      g_platform_mesh->reset_counters();
+    if (g_platform_instances != NULL) g_platform_instances->reset_counters();
+
+    if (g_background_layer != NULL)
+    {
+        g_background_layer->follow(g_camera.get_position());
+        if (!g_background_layer->is_valid())
+        {
+            g_background_layer->begin_capture();
+            glClear(GL_COLOR_BUFFER_BIT);
+            submit_background();
+            g_render_queue.execute(g_sprite_batch, g_gpu_profiler);
+            g_background_layer->end_capture();
+        }
+
+        // The copy is opaque over the whole viewport, so there is nothing to clear first.
+        // It is timed as the background, which it stands in for.
+        if (g_gpu_profiler != NULL) g_gpu_profiler->begin_pass(RENDER_BACKGROUND);
+        g_background_layer->blit();
+        if (g_gpu_profiler != NULL) g_gpu_profiler->end_pass();
+    }
+    else
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+        submit_background();
+    }
+
+    submit_platforms();
+
+    for (const SnapshotSprite &sprite : snapshot.sprites)
+    {
+        g_render_queue.submit_sprite(sprite.layer, sprite.state.texture_id,
+                                     Transform2D::interpolate(sprite.previous, sprite.state.transform, alpha),
+                                     sprite.state.uv_offset, sprite.state.uv_size);
     }
     
-    if(ifGameEnd && ifWin){
-        draw_text(&g_shader_program, g_font_texture_id, "You Win!", 0.5f, 0.05f,
-                      glm::vec3(-3.5f, 2.0f, 0.0f));
+    if(snapshot.is_game_over && !snapshot.has_won){
+        draw_text(&g_render_queue, RENDER_END_TEXT, g_font_region, "**You Lose**", 0.5f, 0.05f,
+                      screen_origin + glm::vec3(-3.1f, 3.0f, 0.0f));
     }
     
-    g_state.target->render(&g_shader_program);
+    if(snapshot.is_game_over && snapshot.has_won){
+        draw_text(&g_render_queue, RENDER_END_TEXT, g_font_region, "You Win!", 0.5f, 0.05f,
+                      screen_origin + glm::vec3(-3.5f, 2.0f, 0.0f));
+    }
     
-    draw_text(&g_shader_program, g_font_texture_id, "left-move left  right-move right", 0.23f, 0.0f, glm::vec3(-4.8f, -3.3f, 0.0f));
-    draw_text(&g_shader_program, g_font_texture_id, "space-jump  down-hide(hide you from attack)", 0.23f, -0.0f, glm::vec3(-4.8f, -3.6f, 0.0f));
+    draw_text(&g_render_queue, RENDER_HINT_TEXT, g_font_region, "left-move left  right-move right", 0.23f, 0.0f, screen_origin + glm::vec3(-4.8f, -3.3f, 0.0f));
+    draw_text(&g_render_queue, RENDER_HINT_TEXT, g_font_region, "space-jump  down-hide(hide you from attack)", 0.23f, -0.0f, screen_origin + glm::vec3(-4.8f, -3.6f, 0.0f));
+
+    if(snapshot.show_jump_scare){
+        g_render_queue.submit_sprite(RENDER_JUMPSCARE, g_jump_scare_sprite.texture_id, g_jump_scare_sprite.transform,
+                                     g_jump_scare_sprite.uv_offset, g_jump_scare_sprite.uv_size);
+    }
+
+    if (g_gpu_profiler != NULL) draw_gpu_profile(screen_origin);
+
+    // Consecutive sprites sharing a texture go out as one draw
+    g_render_queue.execute(g_sprite_batch, g_gpu_profiler);
+    if (g_gpu_profiler != NULL) g_gpu_profiler->end_frame();
 
-    if(jump_scare_counter>=290 && !ifScreamed){
-        ifScreamed = true;
-        Mix_PlayChannel(NEXT_CHNL, g_jump_sfx, 0);
+    FrameStats &stats = g_frame_stats;
+    stats.draw_calls     = g_sprite_batch->get_draw_calls();
+    stats.sprite_count   = g_sprite_batch->get_sprite_count();
+    stats.culled_count   = g_render_queue.get_culled_count();
+    stats.bytes_uploaded = g_sprite_batch->get_stream()->get_bytes_written();
+    stats.shader_calls_issued  = ShaderProgram::get_calls_issued();
+    stats.shader_calls_skipped = ShaderProgram::get_calls_skipped();
+
+    if (g_platform_mesh != NULL)
+    {
+        stats.draw_calls   += g_platform_mesh->get_draw_calls();
+        stats.sprite_count += g_platform_mesh->get_drawn_sprites();
+        stats.culled_count += g_platform_mesh->get_sprite_count() - g_platform_mesh->get_drawn_sprites();
     }
-    if(jump_scare_counter>=300){
-        g_state.jumpscare->render(&g_shader_program);
+    else if (g_platform_instances != NULL)
+    {
+        stats.draw_calls   += g_platform_instances->get_draw_calls();
+        stats.sprite_count += g_platform_instances->get_drawn_instances();
+        stats.culled_count += g_platform_instances->get_instance_count() - g_platform_instances->get_drawn_instances();
     }
+    else
+    {
+        stats.culled_count += g_platform_visibility.get_count();
+        for (const VisibilityIndex::Range &range : g_visible_platforms) stats.culled_count -= range.count;
+    }
+}
+
+void render()
+{
+    g_snapshots.acquire();
+    const FrameSnapshot &snapshot = g_snapshots.get_read_slot();
+
+    // Drawing runs one step behind the simulation, so that there are always two steps
+    // to blend between: alpha is how far the clock has gone past the latest of them
+    float now   = (float) SDL_GetTicks() / MILLISECONDS_IN_SECOND;
+    float alpha = glm::clamp((now - snapshot.step_time) / g_fixed_timestep, 0.0f, 1.0f);
+
+    draw_frame(snapshot, alpha);
+
+    const FrameStats &stats = g_frame_stats;
+    if (g_log_draws && memcmp(&stats, &g_logged_stats, sizeof(FrameStats)) != 0)
+    {
+        g_logged_stats = stats;
+        std::cout << "draw calls: " << stats.draw_calls << " for " << stats.sprite_count << " sprites (" << stats.culled_count << " culled), shader calls: "
+                  << stats.shader_calls_issued << " issued, " << stats.shader_calls_skipped << " skipped, "
+                  << stats.bytes_uploaded << " bytes uploaded\n";
+    }
+
     SDL_GL_SwapWindow(g_display_window);
 }
 
+// Steps the game on its own thread until it is quit. A slow swap on the main thread
+// no longer holds up the simulation, which only waits for its next step.
+void simulation_loop()
+{
+    while (g_app_status == RUNNING)
+    {
+        apply_input();
+        update();
+        SDL_Delay(1);
+    }
+}
+
 void shutdown()
 {
+    // These free vertex buffers, so the context must still be alive
+    delete g_sprite_batch;
+    delete g_platform_instances;
+    delete g_platform_mesh;
+    delete g_texture_atlas;
+    delete g_gpu_profiler;
+    delete g_background_layer;
+    if (g_is_headless) g_headless_context.destroy();
     SDL_Quit();
 
     delete [] g_state.base_platforms;
@@ -616,20 +1034,153 @@ void shutdown()
     delete [] g_state.enemies;
     delete g_state.player;
     delete g_state.background;
+    delete g_state.target;
+    delete g_state.jumpscare;
+    delete g_state.world;
+    delete g_state.jobs;
+}
+
+// Steps and draws g_bench_frames frames back to back on this thread, with nothing
+// presented, and reports what drawing them cost. Every frame is drawn at its latest
+// step, so the output only depends on the simulation and not on the clock.
+void run_render_benchmark()
+{
+    double total_ms = 0.0, min_ms = 1e9, max_ms = 0.0;
+    long   draw_calls = 0, sprite_count = 0, culled_count = 0, bytes_uploaded = 0;
+    uint64_t frames_hash = 14695981039346656037ULL;
+
+    for (int frame = 0; frame < g_bench_frames; frame++)
+    {
+        step();
+        publish_snapshot(frame * g_fixed_timestep);
+        g_snapshots.acquire();
+
+        auto start = std::chrono::steady_clock::now();
+        draw_frame(g_snapshots.get_read_slot(), 1.0f);
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+
+        double frame_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        total_ms += frame_ms;
+        min_ms = std::min(min_ms, frame_ms);
+        max_ms = std::max(max_ms, frame_ms);
+
+        draw_calls     += g_frame_stats.draw_calls;
+        sprite_count   += g_frame_stats.sprite_count;
+        culled_count   += g_frame_stats.culled_count;
+        bytes_uploaded += g_frame_stats.bytes_uploaded;
+
+        if (g_hash_frames) frames_hash = (frames_hash ^ g_headless_context.hash_framebuffer()) * 1099511628211ULL;
+    }
+
+    int frames = std::max(g_bench_frames, 1);
+    std::cout << "frames\tavg ms\tmin ms\tmax ms\tdraws\tsprites\tculled\tbytes/frame\n";
+    std::cout << g_bench_frames << "\t" << total_ms / frames << "\t" << min_ms << "\t" << max_ms << "\t"
+              << draw_calls / frames << "\t" << sprite_count / frames << "\t" << culled_count / frames << "\t"
+              << bytes_uploaded / frames << '\n';
+    if (g_hash_frames) std::cout << "frames hash: " << std::hex << frames_hash << std::dec << '\n';
 }
 
 // ––––– GAME LOOP ––––– //
 int main(int argc, char* argv[])
 {
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--bench-collision")
+        {
+            run_collision_benchmark();
+            return 0;
+        }
+        if (argument == "--bench-bvh")
+        {
+            run_bvh_benchmark();
+            return 0;
+        }
+        if (argument == "--bench-overlap")
+        {
+            run_overlap_benchmark();
+            return 0;
+        }
+        if (argument == "--bench-timestep")
+        {
+            return run_timestep_benchmark() ? 0 : 1;
+        }
+        if (argument == "--bench-sleep")
+        {
+            run_sleep_benchmark();
+            return 0;
+        }
+        if (argument == "--bench-replay")
+        {
+            run_replay_benchmark();
+            return 0;
+        }
+        if (argument == "--bench-enemies")
+        {
+            run_enemy_benchmark();
+            return 0;
+        }
+        if (argument == "--bench-text")
+        {
+            run_text_benchmark();
+            return 0;
+        }
+        if (argument == "--bench-render-queue")
+        {
+            run_render_queue_benchmark();
+            return 0;
+        }
+        if (argument == "--bench-culling")
+        {
+            run_culling_benchmark();
+            return 0;
+        }
+        if (argument == "--bench-render" && i + 1 < argc)
+        {
+            g_bench_frames = atoi(argv[++i]);
+            g_is_headless  = true;
+        }
+        if (argument == "--hash-frames")  g_hash_frames  = true;
+        if (argument == "--validate-bvh") g_validate_bvh = true;
+        if (argument == "--log-sleep")    g_log_sleep    = true;
+        if (argument == "--log-vram")     g_log_vram     = true;
+        if (argument == "--log-draws")    g_log_draws    = true;
+        if (argument == "--profile-gpu")  g_profile_gpu  = true;
+        if (argument == "--platforms" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode == "batched")   g_platform_mode = PLATFORMS_BATCHED;
+            if (mode == "instanced") g_platform_mode = PLATFORMS_INSTANCED;
+            if (mode == "baked")     g_platform_mode = PLATFORMS_BAKED;
+        }
+        if (argument == "--no-atlas")     g_use_atlas    = false;
+        if (argument == "--no-layer-cache") g_use_layer_cache = false;
+        if (argument == "--physics-hz" && i + 1 < argc)
+        {
+            float rate = (float) atof(argv[++i]);
+            if (rate > 0.0f) g_fixed_timestep = 1.0f / rate;
+        }
+    }
+
     initialise();
 
+    if (g_is_headless)
+    {
+        run_render_benchmark();
+        shutdown();
+        return 0;
+    }
+
+    std::thread simulation_thread(simulation_loop);
+
     while (g_app_status == RUNNING)
     {
         process_input();
-        update();
         render();
     }
 
+    simulation_thread.join();
     shutdown();
     return 0;
 }
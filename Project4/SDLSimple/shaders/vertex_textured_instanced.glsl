@@ -0,0 +1,21 @@
+attribute vec4 position;
+attribute vec2 texCoord;
+
+// Per instance: the x, y and z rows of the sprite's model matrix, and where its
+// frame sits in the texture (offset in xy, size in zw)
+attribute vec4 instanceRowX;
+attribute vec4 instanceRowY;
+attribute vec4 instanceRowZ;
+attribute vec4 instanceUV;
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+varying vec2 texCoordVar;
+
+void main()
+{
+	vec4 world = vec4(dot(instanceRowX, position), dot(instanceRowY, position), dot(instanceRowZ, position), 1.0);
+    texCoordVar = instanceUV.xy + texCoord * instanceUV.zw;
+	gl_Position = projectionMatrix * viewMatrix * world;
+}